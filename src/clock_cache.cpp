@@ -0,0 +1,136 @@
+#include "clock_cache.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <exception>
+#include <time.h>
+
+namespace
+{
+	struct snapshot {
+		clock_cache::http_date_buffer http_date;
+		clock_cache::timestamp_buffer timestamp;
+	};
+
+	std::time_t coarse_now() noexcept
+	{
+		timespec ts {};
+		clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+		return ts.tv_sec;
+	}
+
+	snapshot render(const std::chrono::time_zone* zone, std::time_t t)
+	{
+		snapshot next {};
+		const std::chrono::sys_seconds now {std::chrono::seconds{t}};
+		std::format_to_n(next.http_date.data(), next.http_date.size(), "{:%a, %d %b %Y %H:%M:%S GMT}", now);
+		if (zone)
+			std::format_to_n(next.timestamp.data(), next.timestamp.size(), "{:%FT%T}", zone->to_local(now));
+		else
+			std::format_to_n(next.timestamp.data(), next.timestamp.size(), "{:%FT%T}", now);
+		return next;
+	}
+
+	//the snapshot as relaxed atomic words, so copying it while the writer stores a new one is not a data race
+	constexpr size_t payload_words {(sizeof(snapshot) + sizeof(uint64_t) - 1) / sizeof(uint64_t)};
+	using payload = std::array<std::atomic<uint64_t>, payload_words>;
+
+	void store(payload& p, const snapshot& value) noexcept
+	{
+		std::array<uint64_t, payload_words> words {};
+		std::memcpy(words.data(), &value, sizeof(value));
+		for (size_t i = 0; i < payload_words; i++)
+			p[i].store(words[i], std::memory_order_relaxed);
+	}
+
+	snapshot load(const payload& p) noexcept
+	{
+		std::array<uint64_t, payload_words> words;
+		for (size_t i = 0; i < payload_words; i++)
+			words[i] = p[i].load(std::memory_order_relaxed);
+		snapshot value;
+		std::memcpy(&value, words.data(), sizeof(value));
+		return value;
+	}
+
+	//seqlock: the writer makes seq odd while it stores a new snapshot, readers retry if seq was odd or changed
+	struct clock_state {
+		std::atomic<uint64_t> seq {0};
+		std::atomic<std::time_t> second {-1};
+		std::atomic_flag rendering;
+		payload data;
+		const std::chrono::time_zone* zone {nullptr};
+
+		clock_state() noexcept
+		{
+			try {
+				zone = std::chrono::get_tzdb().current_zone();
+			} catch (const std::exception&) {
+				zone = nullptr; //no tzdata in the image, local time is UTC
+			}
+			const auto t {coarse_now()};
+			store(data, render(zone, t));
+			second.store(t, std::memory_order_release);
+		}
+	};
+
+	clock_state& state() noexcept
+	{
+		static clock_state s;
+		return s;
+	}
+
+	//only one thread renders a new second, the others keep reading the previous one meanwhile
+	void refresh(clock_state& s, std::time_t t) noexcept
+	{
+		if (s.rendering.test_and_set(std::memory_order_acquire))
+			return;
+		if (s.second.load(std::memory_order_relaxed) != t) {
+			const snapshot next {render(s.zone, t)};
+			const auto seq {s.seq.load(std::memory_order_relaxed)};
+			s.seq.store(seq + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			store(s.data, next);
+			s.seq.store(seq + 2, std::memory_order_release);
+			s.second.store(t, std::memory_order_release);
+		}
+		s.rendering.clear(std::memory_order_release);
+	}
+
+	template<typename Buffer>
+	std::string_view read(Buffer snapshot::* field, Buffer& out) noexcept
+	{
+		auto& s {state()};
+		if (const auto t {coarse_now()}; s.second.load(std::memory_order_acquire) != t)
+			refresh(s, t);
+		while (true) {
+			const auto before {s.seq.load(std::memory_order_acquire)};
+			if (before & 1)
+				continue;
+			out = load(s.data).*field;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (s.seq.load(std::memory_order_relaxed) == before)
+				return {out.data(), out.size()};
+		}
+	}
+}
+
+namespace clock_cache
+{
+	std::string_view http_date(http_date_buffer& out) noexcept
+	{
+		return read(&snapshot::http_date, out);
+	}
+
+	std::string_view local_timestamp(timestamp_buffer& out) noexcept
+	{
+		return read(&snapshot::timestamp, out);
+	}
+
+	std::time_t now() noexcept
+	{
+		return coarse_now();
+	}
+}
@@ -0,0 +1,39 @@
+/**
+ * @file clock_cache.h
+ * @brief Process-wide clock that pre-renders the Date header and the local timestamp once per second.
+ */
+
+#ifndef CLOCK_CACHE_H_
+#define CLOCK_CACHE_H_
+
+#include <array>
+#include <ctime>
+#include <string_view>
+
+/**
+ * @brief Process-wide clock that pre-renders the Date header and the local timestamp once per second.
+ *
+ * The texts are formatted by the first caller that observes a new second (CLOCK_REALTIME_COARSE, a vDSO read)
+ * and published through a seqlock, every other call copies them out, so the steady-state cost of a Date header
+ * is a 29-byte memcpy and the timezone database is looked up once per process instead of once per call.
+ * Safe to call from any thread, including the reactors and the worker pool.
+ */
+namespace clock_cache
+{
+	constexpr size_t http_date_size {29};
+	constexpr size_t timestamp_size {19};
+
+	using http_date_buffer = std::array<char, http_date_size>;
+	using timestamp_buffer = std::array<char, timestamp_size>;
+
+	/** @brief IMF-fixdate of the current second (Sun, 06 Nov 1994 08:49:37 GMT), copied into out */
+	std::string_view http_date(http_date_buffer& out) noexcept;
+
+	/** @brief yyyy-mm-ddThh:mm:ss of the current second in the local timezone, copied into out */
+	std::string_view local_timestamp(timestamp_buffer& out) noexcept;
+
+	/** @brief seconds since the epoch, same resolution as the texts above */
+	std::time_t now() noexcept;
+}
+
+#endif /* CLOCK_CACHE_H_ */
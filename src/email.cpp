@@ -1,4 +1,5 @@
 #include "email.h"
+#include "clock_cache.h"
 
 namespace {
 
@@ -61,8 +62,9 @@ namespace smtp
 		if (auto pos = username.find("@"); pos != std::string::npos) 
 			domain = username.substr(pos);
 		
+		clock_cache::http_date_buffer date;
 		std::vector<std::string> mail_headers {
-			std::format("Date: {:%a, %d %b %Y %H:%M:%S GMT}", std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now())),
+			std::format("Date: {}", clock_cache::http_date(date)),
 			"To: " + to,
 			"From: " + username,
 			"Cc: " + cc,
@@ -1,4 +1,5 @@
 #include "env.h"
+#include <type_traits>
 
 namespace 
 {
@@ -6,20 +7,36 @@ namespace
 	
 	struct env_vars 
 	{
-			unsigned short int read_env(const char* name, unsigned short int default_value) const noexcept;
+			//a value that does not fit in T is rejected with a warning and the default is kept
+			template<typename T = unsigned short int>
+			T read_env(const char* name, std::type_identity_t<T> default_value) const noexcept;
 			unsigned short int port{read_env("CPP_PORT", 8080)};
 			unsigned short int http_log{read_env("CPP_HTTP_LOG", 0)};
 			unsigned short int login_log{read_env("CPP_LOGIN_LOG", 0)};
 			unsigned short int pool_size{read_env("CPP_POOL_SIZE", 4)};
+			unsigned short int reactors{read_env("CPP_REACTORS", 1)};
+			unsigned short int keepalive_timeout{read_env("CPP_KEEPALIVE_TIMEOUT", 30)};
+			unsigned short int keepalive_requests{read_env("CPP_KEEPALIVE_REQUESTS", 1000)};
+			unsigned short int header_timeout{read_env("CPP_HEADER_TIMEOUT", 10)};
+			unsigned int max_header_size{read_env<unsigned int>("CPP_MAX_HEADER_SIZE", 32768)};
+			unsigned int max_body_kb{read_env<unsigned int>("CPP_MAX_BODY_KB", 10240)};
+			unsigned short int body_timeout{read_env("CPP_BODY_TIMEOUT", 30)};
+			unsigned short int write_timeout{read_env("CPP_WRITE_TIMEOUT", 30)};
+			unsigned short int accept_batch{read_env("CPP_ACCEPT_BATCH", 64)};
+			unsigned short int tcp_nodelay{read_env("CPP_TCP_NODELAY", 1)};
+			unsigned short int defer_accept{read_env("CPP_DEFER_ACCEPT", 0)};
+			unsigned short int tcp_fastopen{read_env("CPP_TCP_FASTOPEN", 0)};
+			unsigned short int compression_level{read_env("CPP_COMPRESSION_LEVEL", 1)};
+			unsigned short int compression_min_size{read_env("CPP_COMPRESSION_MIN_SIZE", 1024)};
+			unsigned short int cache_mb{read_env("CPP_CACHE_MB", 64)};
 			unsigned short int jwt_expiration{read_env("CPP_JWT_EXP", 600)};
 			unsigned short int enable_audit{read_env("CPP_ENABLE_AUDIT", 0)};
 	};	
 
-	const env_vars ev;
-	
-	unsigned short int env_vars::read_env(const char* name, unsigned short int default_value) const noexcept
+	template<typename T>
+	T env_vars::read_env(const char* name, std::type_identity_t<T> default_value) const noexcept
 	{
-		unsigned short int value{default_value};
+		T value{default_value};
 		if (const char* env_p = std::getenv(name)) {
 			std::string_view str(env_p);
 			auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
@@ -30,6 +47,8 @@ namespace
 		}
 		return value;
 	}
+
+	const env_vars ev;
 }
 
 namespace env
@@ -58,6 +77,51 @@ namespace env
 	unsigned short int pool_size() noexcept 
 	{ return ev.pool_size; }
 
+	unsigned short int reactors() noexcept 
+	{ return ev.reactors; }
+
+	unsigned short int keepalive_timeout() noexcept 
+	{ return ev.keepalive_timeout; }
+
+	unsigned short int keepalive_requests() noexcept 
+	{ return ev.keepalive_requests; }
+
+	unsigned short int header_timeout() noexcept 
+	{ return ev.header_timeout; }
+
+	unsigned int max_header_size() noexcept 
+	{ return ev.max_header_size; }
+
+	unsigned int max_body_kb() noexcept 
+	{ return ev.max_body_kb; }
+
+	unsigned short int body_timeout() noexcept 
+	{ return ev.body_timeout; }
+
+	unsigned short int write_timeout() noexcept 
+	{ return ev.write_timeout; }
+
+	unsigned short int accept_batch() noexcept 
+	{ return ev.accept_batch; }
+
+	unsigned short int tcp_nodelay() noexcept 
+	{ return ev.tcp_nodelay; }
+
+	unsigned short int defer_accept() noexcept 
+	{ return ev.defer_accept; }
+
+	unsigned short int tcp_fastopen() noexcept 
+	{ return ev.tcp_fastopen; }
+
+	unsigned short int compression_level() noexcept 
+	{ return ev.compression_level > 9 ? 9 : ev.compression_level; }
+
+	unsigned short int compression_min_size() noexcept 
+	{ return ev.compression_min_size; }
+
+	unsigned short int cache_mb() noexcept 
+	{ return ev.cache_mb; }
+
 	unsigned short int login_log_enabled() noexcept 
 	{ return ev.login_log; }
 
@@ -32,6 +32,51 @@ namespace env
 	/** @brief returns CPP_POOL_SIZE environment variable */
 	unsigned short int pool_size() noexcept;
 	
+	/** @brief returns CPP_REACTORS environment variable, number of epoll threads accepting connections */
+	unsigned short int reactors() noexcept;
+	
+	/** @brief returns CPP_KEEPALIVE_TIMEOUT environment variable, idle seconds before a persistent connection is closed, 0 disables keep-alive */
+	unsigned short int keepalive_timeout() noexcept;
+	
+	/** @brief returns CPP_KEEPALIVE_REQUESTS environment variable, max number of requests served by a persistent connection */
+	unsigned short int keepalive_requests() noexcept;
+	
+	/** @brief returns CPP_HEADER_TIMEOUT environment variable, seconds a new connection has to send its request headers */
+	unsigned short int header_timeout() noexcept;
+	
+	/** @brief returns CPP_MAX_HEADER_SIZE environment variable, max bytes of the request line and headers, larger requests get a 431 */
+	unsigned int max_header_size() noexcept;
+	
+	/** @brief returns CPP_MAX_BODY_KB environment variable, max KB of a request body unless its API sets its own limit, larger ones get a 413, 0 means no limit */
+	unsigned int max_body_kb() noexcept;
+	
+	/** @brief returns CPP_BODY_TIMEOUT environment variable, max seconds between two reads of a request body */
+	unsigned short int body_timeout() noexcept;
+	
+	/** @brief returns CPP_WRITE_TIMEOUT environment variable, max seconds a response write can stall */
+	unsigned short int write_timeout() noexcept;
+	
+	/** @brief returns CPP_ACCEPT_BATCH environment variable, max connections accepted per listen socket event, accepts in flight per io_uring reactor */
+	unsigned short int accept_batch() noexcept;
+	
+	/** @brief returns CPP_TCP_NODELAY environment variable, disables Nagle on client sockets */
+	unsigned short int tcp_nodelay() noexcept;
+	
+	/** @brief returns CPP_DEFER_ACCEPT environment variable, TCP_DEFER_ACCEPT seconds, 0 disables it */
+	unsigned short int defer_accept() noexcept;
+	
+	/** @brief returns CPP_TCP_FASTOPEN environment variable, TCP_FASTOPEN queue length, 0 disables it */
+	unsigned short int tcp_fastopen() noexcept;
+	
+	/** @brief returns CPP_COMPRESSION_LEVEL environment variable, zlib level 1-9 of gzip/deflate responses, 0 disables compression */
+	unsigned short int compression_level() noexcept;
+	
+	/** @brief returns CPP_COMPRESSION_MIN_SIZE environment variable, smaller response bodies are sent uncompressed */
+	unsigned short int compression_min_size() noexcept;
+	
+	/** @brief returns CPP_CACHE_MB environment variable, memory bound of the response cache of the APIs with a cache TTL, 0 disables it */
+	unsigned short int cache_mb() noexcept;
+	
 	/** @brief returns CPP_LOGIN_LOG environment variable */
 	unsigned short int login_log_enabled() noexcept;
 
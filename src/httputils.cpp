@@ -1,7 +1,16 @@
 #include "httputils.h"
 #include <utility>
 #include <future>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <limits>
+#define ZLIB_CONST
+#include <zlib.h>
 #include "async.hpp"
+#include "simd_scan.h"
+#include "clock_cache.h"
 
 namespace
 {
@@ -18,148 +27,343 @@ namespace
 			return std::make_pair(false, 0);
 	}
 
-	constexpr bool is_valid_date(std::string_view strdate) noexcept
+	//yyyy-mm-dd
+	constexpr std::optional<std::chrono::year_month_day> parse_date(std::string_view strdate) noexcept
 	{
 		//note: GCC-13 chrono implementation does not support from_stream() nor parse()
-		if (strdate.size() != 10) //must be yyyy-mm-dd
-			return false;
+		if (strdate.size() != 10 || strdate[4] != '-' || strdate[7] != '-')
+			return std::nullopt;
 		const auto [y_ok, y] {is_valid_number<int>(strdate.substr(0, 4))};
 		const auto [m_ok, m] {is_valid_number<int>(strdate.substr(5, 2))};
 		const auto [d_ok, d] {is_valid_number<int>(strdate.substr(8, 2))};
 		if (!y_ok || !m_ok || !d_ok)
-			return false;
-		const auto ymd {std::chrono::year(y)/std::chrono::month(m)/std::chrono::day(d)};
-		if (ymd.ok())
-			return true;
-		else
-			return false;
+			return std::nullopt;
+		if (const auto ymd {std::chrono::year(y)/std::chrono::month(m)/std::chrono::day(d)}; ymd.ok())
+			return ymd;
+		return std::nullopt;
+	}
+
+	constexpr bool iequals(std::string_view a, std::string_view b) noexcept
+	{
+		return std::ranges::equal(a, b, [](unsigned char x, unsigned char y) { return std::tolower(x) == std::tolower(y); });
+	}
+
+	constexpr bool icontains(std::string_view str, std::string_view token) noexcept
+	{
+		return !std::ranges::search(str, token, [](unsigned char x, unsigned char y) { return std::tolower(x) == std::tolower(y); }).empty();
+	}
+
+	//optional whitespace around a header value
+	constexpr std::string_view trim_ows(std::string_view str) noexcept
+	{
+		const auto first {str.find_first_not_of(" \t")};
+		if (first == std::string_view::npos)
+			return str.substr(str.size());
+		return str.substr(first, str.find_last_not_of(" \t") - first + 1);
+	}
+
+	//same order as header_table::known
+	constexpr std::array<std::string_view, static_cast<size_t>(http::header_table::known::count)> known_headers {
+		"content-length", "content-type", "authorization", "origin", "x-forwarded-for", "x-request-id", "connection",
+		"transfer-encoding", "expect", "accept-encoding", "if-none-match"
+	};
+
+	constexpr char to_lower_ascii(char c) noexcept
+	{
+		return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+	}
+
+	//perfect hash of the known header names: length plus first letter, checked for collisions at compile time
+	constexpr size_t known_header_slots {32};
+
+	constexpr size_t known_header_hash(std::string_view name) noexcept
+	{
+		return (name.size() + static_cast<unsigned char>(to_lower_ascii(name[0]))) & (known_header_slots - 1);
+	}
+
+	constexpr auto make_known_header_table() noexcept
+	{
+		std::array<int8_t, known_header_slots> table;
+		table.fill(-1);
+		for (size_t i = 0; i < known_headers.size(); i++) {
+			if (table[known_header_hash(known_headers[i])] != -1)
+				return std::array<int8_t, known_header_slots>{}; //collision, rejected by the static_assert below
+			table[known_header_hash(known_headers[i])] = static_cast<int8_t>(i);
+		}
+		return table;
+	}
+
+	constexpr std::array<int8_t, known_header_slots> known_header_table {make_known_header_table()};
+	static_assert(std::ranges::count(known_header_table, -1) == known_header_slots - known_headers.size(),
+		"known header names collide, change known_header_hash()");
+
+	//one table probe and at most one comparison, whatever the header
+	constexpr int known_header_index(std::string_view name) noexcept
+	{
+		if (name.empty())
+			return -1;
+		const int k {known_header_table[known_header_hash(name)]};
+		if (k < 0 || known_headers[k].size() != name.size() || !iequals(known_headers[k], name))
+			return -1;
+		return k;
 	}
 
-	constexpr std::string lowercase(std::string_view sv) noexcept 
+	//case-insensitive FNV-1a, used to index the header names received
+	constexpr uint32_t header_name_hash(std::string_view name) noexcept
 	{
-		std::string s {sv};
-		std::ranges::transform( s, s.begin(), [](unsigned char c){ return std::tolower(c); } );
-		return s;
+		uint32_t h {2166136261u};
+		for (const char c: name) {
+			h ^= static_cast<unsigned char>(to_lower_ascii(c));
+			h *= 16777619u;
+		}
+		return h;
 	}
 	
-	constexpr std::string trim(const std::string & source)
+	constexpr std::array<int8_t, 256> make_hex_table() noexcept
 	{
-		std::string s(source);
-		s.erase(0, s.find_first_not_of(" "));
-		s.erase(s.find_last_not_of(" ") + 1);
-		return s;
+		std::array<int8_t, 256> table;
+		table.fill(-1);
+		for (int i = 0; i < 10; i++)
+			table['0' + i] = static_cast<int8_t>(i);
+		for (int i = 0; i < 6; i++) {
+			table['a' + i] = static_cast<int8_t>(10 + i);
+			table['A' + i] = static_cast<int8_t>(10 + i);
+		}
+		return table;
 	}
 
-	constexpr void replace_str(std::string &str, std::string_view from, std::string_view to) 
+	constexpr std::array<int8_t, 256> hex_table {make_hex_table()};
+
+	//application/x-www-form-urlencoded: '+' is a space, an invalid escape is kept as is,
+	//runs without escapes are copied in one go
+	void url_decode_append(std::string& out, std::string_view in)
 	{
-		if (from.empty() || to.empty())
-			return;
-		size_t start_pos = 0;
-		while((start_pos = str.find(from, start_pos)) != std::string::npos) {
-			str.replace(start_pos, from.length(), to);
-			start_pos += to.length();
+		size_t pos {0};
+		while (pos < in.size()) {
+			const auto next {in.find_first_of("%+", pos)};
+			out.append(in.substr(pos, next - pos));
+			if (next == std::string_view::npos)
+				break;
+			if (in[next] == '+') {
+				out.push_back(' ');
+				pos = next + 1;
+				continue;
+			}
+			const int hi {next + 2 < in.size() ? hex_table[static_cast<unsigned char>(in[next + 1])] : -1};
+			const int lo {hi >= 0 ? hex_table[static_cast<unsigned char>(in[next + 2])] : -1};
+			if (lo < 0) {
+				out.push_back('%');
+				pos = next + 1;
+				continue;
+			}
+			out.push_back(static_cast<char>(hi << 4 | lo));
+			pos = next + 3;
 		}
-	}	
+	}
+	
+	constexpr std::string_view trim_spaces(std::string_view str) noexcept
+	{
+		const auto first {str.find_first_not_of(' ')};
+		if (first == std::string_view::npos)
+			return str.substr(str.size());
+		return str.substr(first, str.find_last_not_of(' ') - first + 1);
+	}
+
+	//prevent sql injection: quotes are doubled, backslashes are stripped, < and > become HTML entities; 4 bytes out per byte in at most
+	constexpr size_t max_escape_growth {4};
 
-	constexpr auto save_blob(const std::string& filename, const std::string& content)
+	constexpr void escape_string(std::string_view value, std::string& out)
 	{
-		bool result{true};
-		std::string errmsg {""};
-		if (std::ofstream ofs(filename, std::ios::binary); ofs.is_open()) {
-			ofs << content;
-			 if (ofs.fail()) {
-				errmsg = std::format("save_blob() failed saving content: {}", std::strerror(errno));
-				result = false;
-			 }		
-		} else {
-			result = false;
-			errmsg = std::format("save_blob() failed: {}", std::strerror(errno));
+		size_t pos {0};
+		while (pos < value.size()) {
+			const auto next {value.find_first_of("'\\<>", pos)};
+			out.append(value.substr(pos, next - pos));
+			if (next == std::string_view::npos)
+				break;
+			switch (value[next]) {
+				case '\'': out.append("''"); break;
+				case '\\': break;
+				case '<': out.append("&lt;"); break;
+				default: out.append("&gt;"); break;
+			}
+			pos = next + 1;
 		}
-		return std::make_pair(result, errmsg);
 	}
 
+	constexpr std::string escaped(std::string_view value)
+	{
+		std::string out;
+		escape_string(value, out);
+		return out;
+	}
+
+	static_assert(escaped("a\\'b") == "a''b");
+	static_assert(escaped("x\\\\y") == "xy");
+	static_assert(escaped("<b>'") == "&lt;b&gt;''");
+
 	//upload support functions---------
 	
-	constexpr void parse_json(auto req) 
+	//a single pass over the body, only the fields declared by the API's input rules are extracted,
+	//all the top-level scalars if it has none; a repeated key keeps its last value
+	void parse_json(auto req) 
 	{
-		std::string_view payload {req->get_body()};
-		json::json_parser p {payload};
-		req->params = p.get_map(); 
+		const auto* plan {req->input_rules};
+		json::json_parser::extract(req->get_body(),
+			[plan](std::string_view key) { return !plan || plan->empty() || plan->find(key) >= 0; },
+			[req](std::string_view key, std::string_view value) { req->params.set(key, value); });
 	}
 
-	constexpr std::vector<std::string_view> parse_body(auto req) {
-		std::vector<std::string_view> vec;
-		std::string_view body {req->payload.view()};
-		body = body.substr(req->internals.bodyStartPos);
-		const std::string delim{ "--" + req->boundary + "\r\n"};
-		const std::string end_delim{"--" + req->boundary + "--" + "\r\n"};
-		for (const auto& word : std::views::split(body, delim)) {
-			auto part {std::string_view{word}};
-			if (part.empty()) continue;
-			if (part.ends_with(end_delim))
-				part = part.substr(0, part.find(end_delim));
-			vec.push_back(part);
+	//value of a Content-Disposition parameter, as in: form-data; name="file1"; filename="report.pdf"
+	constexpr std::string_view disposition_param(std::string_view value, std::string_view param) noexcept
+	{
+		for (const auto& p: std::views::split(value, ';')) {
+			std::string_view attr {trim_ows(std::string_view{p.begin(), p.end()})};
+			const auto eq {attr.find('=')};
+			if (eq == std::string_view::npos || !iequals(trim_ows(attr.substr(0, eq)), param))
+				continue;
+			attr = trim_ows(attr.substr(eq + 1));
+			if (attr.size() >= 2 && attr.front() == '"' && attr.back() == '"')
+				attr = attr.substr(1, attr.size() - 2);
+			return attr;
 		}
-		return vec;
+		return "";
 	}
+	//--------------------------
 
-	constexpr std::vector<std::string_view> parse_part(std::string_view body) {
-		std::vector<std::string_view> vec;
-		for (constexpr std::string_view delim{"\r\n"}; const auto& word : std::views::split(body, delim)) {
-			auto part {std::string_view{word}};
-			if (part.empty()) continue;
-			vec.push_back(part);
+	//q-value of an Accept-Encoding element, as in: gzip;q=0.8
+	double coding_weight(std::string_view params) noexcept
+	{
+		for (const auto& p: std::views::split(params, ';')) {
+			const std::string_view attr {trim_ows(std::string_view{p.begin(), p.end()})};
+			if (attr.size() < 2 || (attr[0] != 'q' && attr[0] != 'Q') || attr[1] != '=')
+				continue;
+			double q {0};
+			const auto [ptr, ec] {std::from_chars(attr.data() + 2, attr.data() + attr.size(), q)};
+			return ec == std::errc() ? q : 0;
 		}
-		return vec;
+		return 1;
 	}
 
-	constexpr std::string_view extract_attribute(std::string_view part, const std::string& name) {
-		const std::string delim1 {name + "=\""};
-		const std::string delim2 {"\""};
-		if (auto pos1 {part.find(delim1)}; pos1 != std::string::npos) {
-			pos1 += delim1.size();
-			if (auto pos2 {part.find(delim2, pos1)}; pos2 != std::string::npos) 
-				return part.substr(pos1, pos2 - pos1);
+	constexpr std::string_view encoding_headers(http::content_coding coding) noexcept
+	{
+		switch (coding) {
+			case http::content_coding::gzip: return "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n";
+			case http::content_coding::deflate: return "Content-Encoding: deflate\r\nVary: Accept-Encoding\r\n";
+			default: return "";
 		}
-		return "";    
 	}
 
-	constexpr std::string_view get_part_content_type(std::string_view line) {
-		std::string_view marker {"Content-Type: "};
-		auto pos = line.find(marker);
-		pos += marker.size();
-		return line.substr(pos);
+	//64-bit wyhash over the response body, three independent multiply lanes on large inputs
+	constexpr uint64_t hash_p0 {0xa0761d6478bd642full};
+	constexpr uint64_t hash_p1 {0xe7037ed1a0b428dbull};
+	constexpr uint64_t hash_p2 {0x8ebc6af09c88c6e3ull};
+	constexpr uint64_t hash_p3 {0x589965cc75374cc3ull};
+
+	inline uint64_t hash_mix(uint64_t a, uint64_t b) noexcept
+	{
+		const auto r {static_cast<unsigned __int128>(a) * b};
+		return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+	}
+
+	inline uint64_t read_u64(const char* p) noexcept
+	{
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64_t read_u32(const char* p) noexcept
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
 	}
 
-	constexpr http::form_field get_form_field(std::vector<std::string_view> part) {
-		http::form_field f;
-		size_t idx{1};
-		f.name = extract_attribute(part[0], "name");
-		f.filename = extract_attribute(part[0], "filename");
-		if (!f.filename.empty()) {
-			f.content_type = get_part_content_type(part[1]);
-			idx = 2;
+	uint64_t body_hash(std::string_view data) noexcept
+	{
+		const char* p {data.data()};
+		const size_t len {data.size()};
+		uint64_t seed {hash_p0};
+		uint64_t a {0};
+		uint64_t b {0};
+		if (len <= 16) {
+			if (len >= 4) {
+				const size_t mid {(len >> 3) << 2};
+				a = read_u32(p) << 32 | read_u32(p + mid);
+				b = read_u32(p + len - 4) << 32 | read_u32(p + len - 4 - mid);
+			} else if (len > 0) {
+				a = static_cast<uint64_t>(static_cast<unsigned char>(p[0])) << 16
+					| static_cast<uint64_t>(static_cast<unsigned char>(p[len >> 1])) << 8
+					| static_cast<unsigned char>(p[len - 1]);
+			}
+		} else {
+			size_t i {len};
+			if (i > 48) {
+				uint64_t seed1 {seed};
+				uint64_t seed2 {seed};
+				do {
+					seed = hash_mix(read_u64(p) ^ hash_p1, read_u64(p + 8) ^ seed);
+					seed1 = hash_mix(read_u64(p + 16) ^ hash_p2, read_u64(p + 24) ^ seed1);
+					seed2 = hash_mix(read_u64(p + 32) ^ hash_p3, read_u64(p + 40) ^ seed2);
+					p += 48;
+					i -= 48;
+				} while (i > 48);
+				seed ^= seed1 ^ seed2;
+			}
+			while (i > 16) {
+				seed = hash_mix(read_u64(p) ^ hash_p1, read_u64(p + 8) ^ seed);
+				p += 16;
+				i -= 16;
+			}
+			a = read_u64(p + i - 16);
+			b = read_u64(p + i - 8);
 		}
-		for (auto i = idx; i < part.size(); i++) {
-			f.data.append(part[i]);
-			if (!f.filename.empty())
-				f.data.append("\r\n");
+		return hash_mix(hash_p1 ^ len, hash_mix(a ^ hash_p1, b ^ seed));
+	}
+
+	//If-None-Match uses the weak comparison: W/"x" and "x" are the same tag
+	constexpr bool etag_matches(std::string_view if_none_match, std::string_view tag) noexcept
+	{
+		if (tag.starts_with("W/"))
+			tag.remove_prefix(2);
+		for (const auto& e: std::views::split(if_none_match, ',')) {
+			std::string_view candidate {trim_ows(std::string_view{e.begin(), e.end()})};
+			if (candidate == "*")
+				return true;
+			if (candidate.starts_with("W/"))
+				candidate.remove_prefix(2);
+			if (candidate == tag)
+				return true;
 		}
-		return f;
+		return false;
 	}
-	
-	constexpr std::vector<http::form_field> parse_multipart(auto req) 
+
+	//one-shot zlib compression into a buffer of deflateBound() bytes, HTTP's deflate is the zlib format
+	bool deflate_body(std::string_view in, std::string& out, http::content_coding coding, int level) noexcept
 	{
-		std::vector<http::form_field> fields;
-		for (const auto& vec {parse_body(req)}; auto& part: vec) {
-			if (part.size() == 0)
-				throw http::invalid_payload_exception("Invalid multipart-form payload, part is empty!");
-			auto elems {parse_part(part)};
-			fields.push_back(get_form_field(elems));
+		if (in.size() > UINT_MAX)
+			return false;
+		z_stream zs {};
+		constexpr int window_bits {15};
+		constexpr int gzip_wrapper {16};
+		const int bits {coding == http::content_coding::gzip ? window_bits + gzip_wrapper : window_bits};
+		if (deflateInit2(&zs, level, Z_DEFLATED, bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			return false;
+		bool ok {false};
+		try {
+			out.resize(deflateBound(&zs, static_cast<uLong>(in.size())));
+			zs.next_in = reinterpret_cast<const Bytef*>(in.data());
+			zs.avail_in = static_cast<uInt>(in.size());
+			zs.next_out = reinterpret_cast<Bytef*>(out.data());
+			zs.avail_out = static_cast<uInt>(out.size());
+			ok = deflate(&zs, Z_FINISH) == Z_STREAM_END;
+			out.resize(zs.total_out);
+		} catch (const std::bad_alloc&) {
+			ok = false;
 		}
-		return fields;
+		deflateEnd(&zs);
+		return ok;
 	}
-	//--------------------------
 
 	//mail and log support------
 	constexpr std::string load_mail_template(const std::string& filename)
@@ -183,13 +387,13 @@ namespace
 		if (std::size_t pos = body.find(sessionid_marker); pos != std::string::npos)
 			body.replace(pos, sessionid_marker.size(), "'" + req->user_info.sessionid + "'");
 		
-		if (req->input_rules.empty())
+		if (!req->input_rules)
 			return body;
-		for (const auto& p:req->input_rules)
+		for (const auto& p:req->input_rules->rules())
 		{
 			std::string name {"$" + p.get_name()};
 			if (std::size_t pos = body.find(name); pos != std::string::npos) {
-				const auto& value = req->params[p.get_name()];
+				const auto value {req->params.get(p.get_name())};
 				if (value.empty()) 
 					body.replace(pos, name.length(), "");
 				else
@@ -221,19 +425,32 @@ namespace http
 		return std::string(uuid.data());
 	}
 
-	line_reader::line_reader(std::string_view str) : buffer{str} { }
-	
-	bool line_reader::eof() const noexcept { return _eof; }
-	
-	std::string_view line_reader::getline() {
-		if (auto newpos = buffer.find(line_sep, pos); newpos != std::string::npos && newpos!= 0) {
-			std::string_view line { buffer.substr( pos, newpos - pos ) };
-			pos = newpos + line_sep.size();
-			return line;
-		} else {
-			_eof = true;
-			return "";
+	content_coding negotiate_encoding(std::string_view accept_encoding) noexcept
+	{
+		double gzip {-1};
+		double deflate {-1};
+		double any {-1};
+		for (const auto& e: std::views::split(accept_encoding, ',')) {
+			const std::string_view element {trim_ows(std::string_view{e.begin(), e.end()})};
+			const auto semicolon {element.find(';')};
+			const std::string_view name {trim_ows(element.substr(0, semicolon))};
+			const double q {semicolon == std::string_view::npos ? 1 : coding_weight(element.substr(semicolon + 1))};
+			if (iequals(name, "gzip") || iequals(name, "x-gzip"))
+				gzip = q;
+			else if (iequals(name, "deflate"))
+				deflate = q;
+			else if (name == "*")
+				any = q;
 		}
+		if (gzip < 0)
+			gzip = any;
+		if (deflate < 0)
+			deflate = any;
+		if (gzip > 0 && gzip >= deflate)
+			return content_coding::gzip;
+		if (deflate > 0)
+			return content_coding::deflate;
+		return content_coding::identity;
 	}
 
 	response_stream::response_stream() {
@@ -241,66 +458,106 @@ namespace http
 	}
 
 	void response_stream::set_body(std::string_view body, std::string_view content_type)
+	{
+		_body.assign(body);
+		format_headers(content_type, false);
+	}
+	
+	void response_stream::set_body_blob(std::string_view body, std::string_view content_type)
+	{
+		_body.assign(body);
+		format_headers(content_type, true);
+	}
+
+	//the header block is kept apart from _body, write() sends both with a single writev()
+	void response_stream::render_headers()
 	{
 		constexpr auto resp {
 			"HTTP/1.1 200 OK\r\n"
 			"Content-Length: {}\r\n"
 			"Content-Type: {}\r\n"
-			"Date: {:%a, %d %b %Y %H:%M:%S GMT}\r\n"
+			"{}"
+			"Date: {}\r\n"
 			"Access-Control-Allow-Origin: {}\r\n"
 			"Strict-Transport-Security: max-age=31536000; includeSubDomains; preload;\r\n"
 			"X-Frame-Options: SAMEORIGIN\r\n"
 			"X-Content-Type-Options: nosniff\r\n"
 			"Referrer-Policy: no-referrer\r\n"
-			"Cache-Control: no-store\r\n"
+			"Cache-Control: {}\r\n"
+			"{}{}{}"
 			"Cross-Origin-Resource-Policy: cross-origin\r\n"
-			"Connection: close\r\n"
+			"Connection: {}\r\n"
 			"\r\n"
-			"{}" 
 		};
-							
-		_buffer.append(std::format(resp, 
-			body.size(),
-			content_type,
-			std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()),
-			_origin,
-			body
-		));
-	}
-	
-	void response_stream::set_body_blob(std::string_view body, std::string_view content_type)
-	{
-		constexpr auto resp { 	
+
+		constexpr auto resp_blob { 	
 			"HTTP/1.1 200 OK\r\n"
 			"Content-Length: {}\r\n"
 			"Content-Type: {}\r\n"
-			"Date: {:%a, %d %b %Y %H:%M:%S GMT}\r\n"
+			"Date: {}\r\n"
 			"Access-Control-Allow-Origin: {}\r\n"
 			"Access-Control-Expose-Headers: content-disposition\r\n"
 			"Strict-Transport-Security: max-age=31536000; includeSubDomains; preload;\r\n"
 			"X-Frame-Options: SAMEORIGIN\r\n"
 			"X-Content-Type-Options: nosniff\r\n"
 			"Referrer-Policy: no-referrer\r\n"
-			"Cache-Control: no-store\r\n"
+			"Cache-Control: {}\r\n"
+			"{}{}{}"
 			"Cross-Origin-Resource-Policy: cross-origin\r\n"
 			"Content-Disposition: {}\r\n"
-			"Connection: close\r\n"
+			"Connection: {}\r\n"
+			"\r\n"
+		};
+
+		clock_cache::http_date_buffer date;
+		const auto now {clock_cache::http_date(date)};
+		//the ETag line is spliced in pieces, no temporary string
+		const std::string_view etag_prefix {_etag.empty() ? "" : "ETag: "};
+		const std::string_view etag_suffix {_etag.empty() ? "" : "\r\n"};
+		const size_t body_size {body_view().size()};
+		_buffer.resize(_headers_pos);
+		if (!_blob)
+			std::format_to(std::back_inserter(_buffer), resp, body_size, _content_type, encoding_headers(_content_encoding), now, _origin, _cache_control, etag_prefix, _etag, etag_suffix, connection());
+		else
+			std::format_to(std::back_inserter(_buffer), resp_blob, body_size, _content_type, now, _origin, _cache_control, etag_prefix, _etag, etag_suffix, _content_disposition, connection());
+	}
+
+	//304 in place of the 200 whose headers start at _headers_pos, the body is not sent
+	void response_stream::format_not_modified(std::string_view etag)
+	{
+		constexpr auto not_modified {
+			"HTTP/1.1 304 Not Modified\r\n"
+			"ETag: {}\r\n"
+			"Cache-Control: {}\r\n"
+			"Date: {}\r\n"
+			"Access-Control-Allow-Origin: {}\r\n"
+			"Connection: {}\r\n"
 			"\r\n"
-			"{}" 
 		};
-							
-		if (_origin.empty())
+		clock_cache::http_date_buffer date;
+		_body.clear();
+		_shared_body.reset();
+		_compressible = false;
+		_formatted = false;
+		_buffer.resize(_headers_pos);
+		std::format_to(std::back_inserter(_buffer), not_modified, etag, _cache_control, clock_cache::http_date(date), _origin, connection());
+	}
+
+	//a new body, compress() and revalidate() may render its headers again
+	void response_stream::format_headers(std::string_view content_type, bool blob)
+	{
+		_content_type.assign(content_type);
+		_blob = blob;
+		_compressible = !blob && _accept_encoding != content_coding::identity;
+		_content_encoding = content_coding::identity;
+		_etag.clear();
+		_shared_body.reset();
+		_headers_pos = _buffer.size();
+		_formatted = true;
+		if (blob && _origin.empty())
 			logger::log("http", "warn", "set_body_blob() - origin is empty", _x_request_id);
-									
-		_buffer.append(std::format(resp, 
-			body.size(),
-			content_type,
-			std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()),
-			_origin,
-			_content_disposition,
-			body
-		));
-	}	
+		render_headers();
+	}
 	
 	void response_stream::set_content_disposition(std::string_view disposition)
 	{
@@ -316,6 +573,98 @@ namespace http
 	{
 		_x_request_id = req_id;
 	}	
+
+	void response_stream::set_keep_alive(bool keep_alive) noexcept
+	{
+		_keep_alive = keep_alive;
+	}
+
+	void response_stream::set_accept_encoding(content_coding coding) noexcept
+	{
+		_accept_encoding = coding;
+	}
+
+	bool response_stream::keep_alive() const noexcept
+	{
+		return _keep_alive;
+	}
+
+	bool response_stream::compressible(size_t min_size) const noexcept
+	{
+		return _compressible && _body.size() >= min_size;
+	}
+
+	//runs on the worker thread once the API returned, before anything was sent
+	size_t response_stream::compress(int level)
+	{
+		if (!_compressible)
+			return 0;
+		_compressible = false;
+		std::string out;
+		if (!deflate_body(_body, out, _accept_encoding, level) || out.size() >= _body.size())
+			return 0;
+		const size_t saved {_body.size() - out.size()};
+		_body = std::move(out);
+		_content_encoding = _accept_encoding;
+		render_headers();
+		return saved;
+	}
+
+	//runs on the worker thread once the API returned, before compress() so the tag is the same for every coding
+	bool response_stream::revalidate(std::string_view cache_control, std::string_view if_none_match)
+	{
+		if (!_formatted)
+			return false;
+		const auto tag {std::format(R"(W/"{:016x}")", body_hash(_body))};
+		_cache_control.assign(cache_control);
+		if (etag_matches(if_none_match, tag)) {
+			format_not_modified(tag);
+			return true;
+		}
+		_etag = tag;
+		render_headers();
+		return false;
+	}
+
+	//the body moves into a shared string, this response and the snapshot send the same bytes
+	std::shared_ptr<const response_snapshot> response_stream::snapshot()
+	{
+		if (!_formatted || _blob)
+			return nullptr;
+		if (!_shared_body)
+			_shared_body = std::make_shared<const std::string>(std::move(_body));
+		_body.clear();
+		return std::make_shared<const response_snapshot>(_shared_body, _content_type, _etag, _cache_control, _content_encoding);
+	}
+
+	void response_stream::replay(const std::shared_ptr<const response_snapshot>& s, std::string_view if_none_match)
+	{
+		_headers_pos = _buffer.size();
+		_cache_control.assign(s->cache_control);
+		if (!s->etag.empty() && etag_matches(if_none_match, s->etag)) {
+			format_not_modified(s->etag);
+			return;
+		}
+		_body.clear();
+		_shared_body = s->body;
+		_content_type.assign(s->content_type);
+		_etag.assign(s->etag);
+		_content_encoding = s->encoding;
+		_blob = false;
+		_compressible = false;
+		_formatted = false;
+		render_headers();
+	}
+
+	std::string_view response_stream::body_view() const noexcept
+	{
+		return _shared_body ? std::string_view{*_shared_body} : std::string_view{_body};
+	}
+
+	std::string_view response_stream::connection() const noexcept
+	{
+		return _keep_alive ? "keep-alive" : "close";
+	}
 	
 	response_stream& response_stream::operator <<(std::string_view data) {
 		_buffer.append(data);
@@ -323,7 +672,7 @@ namespace http
 	}
 
 	size_t response_stream::size() const noexcept {
-		return _buffer.size();
+		return _buffer.size() + body_view().size();
 	}
 	
 	const char* response_stream::data() const noexcept {
@@ -333,44 +682,108 @@ namespace http
 	void response_stream::clear() noexcept {
 		_pos1 = 0;
 		_buffer.clear();
+		_body.clear();
+		if (_body.capacity() > _max_retained_body)
+			_body.shrink_to_fit();
+		_shared_body.reset();
 		_content_disposition.clear();
 		_origin.clear();
+		_x_request_id.clear();
+		_content_type.clear();
+		_etag.clear();
+		_cache_control.assign(default_cache_control);
+		_keep_alive = false;
+		_headers_pos = 0;
+		_blob = false;
+		_formatted = false;
+		_compressible = false;
+		_accept_encoding = content_coding::identity;
+		_content_encoding = content_coding::identity;
+	}
+
+	//header and body bytes not yet sent, used by the io_uring backend which submits its own sends
+	std::array<std::string_view, 2> response_stream::unsent() const noexcept
+	{
+		const std::string_view header {_buffer};
+		const std::string_view body {body_view()};
+		if (_pos1 < header.size())
+			return {header.substr(_pos1), body};
+		return {std::string_view{}, body.substr(_pos1 - header.size())};
+	}
+
+	size_t response_stream::pending() const noexcept
+	{
+		return size() - _pos1;
+	}
+
+	void response_stream::consume(size_t n) noexcept
+	{
+		_pos1 += std::min(n, pending());
 	}
 
 	bool response_stream::write(int fd) noexcept 
 	{
-		const char* buf = _buffer.c_str();
-		buf += _pos1;
-		const char* end = _buffer.c_str() + _buffer.size();
-		ssize_t count = send(fd, buf, end - buf, MSG_NOSIGNAL);
-		if (count > 0) {
-			buf += count;
-			_pos1 += count;
-		}
-		while (buf != end)
+		while (pending() > 0)
 		{
-			count = send(fd, buf, end - buf, MSG_NOSIGNAL);
+			const auto chunks {unsent()};
+			std::array<iovec, 2> iov;
+			int iovcnt {0};
+			for (const auto& c: chunks) {
+				if (!c.empty())
+					iov[iovcnt++] = {const_cast<char*>(c.data()), c.size()};
+			}
+			//SIGPIPE is ignored by the server, a closed peer surfaces as EPIPE
+			ssize_t count = writev(fd, iov.data(), iovcnt);
 			if (count > 0) {
-				buf += count;
 				_pos1 += count;
 				continue;
-			} else { 
-				if (errno == EAGAIN)
-					return false;
-			}
-			if (count <= 0 && errno != EAGAIN) {
-				logger::log("epoll", "error", std::format("send() error: {} FD: {}", strerror(errno), fd));
-				return true;
 			}
+			if (errno == EAGAIN)
+				return false;
+			logger::log("epoll", "error", std::format("writev() error: {} FD: {}", strerror(errno), fd));
+			return true;
 		}
 		return true;
 	}
 
+	//prepare a persistent connection for its next request, buffers keep their capacity
+	//with keep_pipelined the bytes received past the end of the current message are kept, they start the next request
+	void request::reset(bool keep_pipelined) noexcept
+	{
+		if (const size_t end {message_size()}; keep_pipelined && internals.bodyStartPos > 0 && end < static_cast<size_t>(payload.size()))
+			payload.discard(end);
+		else
+			payload.clear();
+		remote_ip.clear();
+		internals = request_internals{};
+		isMultipart = false;
+		save_blob_failed = false;
+		method.clear();
+		queryString.clear();
+		path.clear();
+		path_params.clear();
+		cache_key.clear();
+		boundary.clear();
+		token.clear();
+		origin.clear();
+		headers.clear();
+		form.reset();
+		params.clear();
+		input_rules = nullptr;
+		user_info = jwt::user_info{};
+		response.clear();
+	}
+
+	void request::cancel_upload() noexcept
+	{
+		form.reset();
+	}
+
 	void request::delete_blobs()
 	{
-		for (const auto& [k, v]:params) {
+		for (const auto& [k, v]:params.items()) {
 			if (k.ends_with(".document")) {
-				std::string _path{http::blob_path + v};
+				std::string _path{http::blob_path + std::string{v}};
 				std::remove(_path.c_str());
 			}
 		}
@@ -382,59 +795,92 @@ namespace http
 			throw method_not_allowed_exception(method);
 	}
 	
-	void request::test_field(const http::input_rule& r, std::string& value)
+	//validates a trimmed, non-empty value, appends it to out (escaped for strings) and keeps its typed value
+	void request::test_field(const http::input_rule& r, std::string_view value, std::string& out, param_value& typed)
 	{
 		using enum field_type;
 		switch (r.get_type()) {
 			case INTEGER:
-				if (const auto [ok, retval] {is_valid_number<int>(value)}; !ok)
+				if (const auto [ok, retval] {is_valid_number<int>(value)}; ok)
+					typed = retval;
+				else
 					throw invalid_input_exception(r.get_name(), "err.invalidtype");
 				break;
 			case DOUBLE:
-				if (const auto [ok, retval] {is_valid_number<double>(value)}; !ok)
+				if (const auto [ok, retval] {is_valid_number<double>(value)}; ok)
+					typed = retval;
+				else
 					throw invalid_input_exception(r.get_name(), "err.invalidtype");
 				break;
 			case DATE:
-				if (!is_valid_date(value))
+				if (const auto ymd {parse_date(value)}; ymd)
+					typed = *ymd;
+				else
 					throw invalid_input_exception(r.get_name(), "err.invalidtype");
 				break;
 			case STRING:
-				//prevent sql injection
-				replace_str(value, "'", "''");
-				replace_str(value, "\\", "");
-				replace_str(value, "<", "&lt;");
-				replace_str(value, ">", "&gt;");
-				break;
+				escape_string(value, out);
+				return;
 		}
+		out.append(value);
 	}
 	
 	//throws invalid_input_exception if any validation rule fails
-	void request::enforce(const std::vector<input_rule>& rules)
+	void request::enforce(const validation_plan& plan)
 	{
-		input_rules = rules; //store in request for later use
-		for (const auto& r: rules) 
+		input_rules = &plan;
+		const auto& rules {plan.rules()};
+		values.assign(rules.size(), std::monostate{});
+		for (size_t i = 0; i < rules.size(); i++) 
 		{
-			if (r.get_required() && !params.contains(r.get_name())) 
+			const auto& r {rules[i]};
+			const bool present {params.rewrite(r.get_name(), params.get(r.get_name()).size() * max_escape_growth,
+				[this, &r, i](std::string_view value, std::string& out) {
+					value = trim_spaces(value);
+					if (r.get_required() && value.empty())
+						throw invalid_input_exception(r.get_name(), "err.required");
+					if (!value.empty())
+						test_field(r, value, out, values[i]);
+				})};
+			if (!present && r.get_required())
 				throw invalid_input_exception(r.get_name(), "err.required");
-			auto& value = params[r.get_name()];
-			value = trim(value);
-			if (r.get_required() && value.empty())
-				throw invalid_input_exception(r.get_name(), "err.required");
-			if (!value.empty())
-				test_field(r, value);
 		}
 	}
 
-	void request::set_parse_error(std::string_view msg)
+	const param_value& request::get_value(std::string_view name) const noexcept
+	{
+		static const param_value empty;
+		if (const int idx {input_rules ? input_rules->find(name) : -1}; idx >= 0 && static_cast<size_t>(idx) < values.size())
+			return values[idx];
+		return empty;
+	}
+
+	validation_plan::validation_plan(std::vector<input_rule> rules): m_rules{std::move(rules)}
+	{
+		m_by_name.resize(m_rules.size());
+		for (size_t i = 0; i < m_by_name.size(); i++)
+			m_by_name[i] = static_cast<uint16_t>(i);
+		std::ranges::sort(m_by_name, std::less<>{}, [this](uint16_t i) -> const std::string& { return m_rules[i].get_name(); });
+	}
+
+	int validation_plan::find(std::string_view name) const noexcept
+	{
+		const auto it {std::ranges::lower_bound(m_by_name, name, std::less<>{}, [this](uint16_t i) -> std::string_view { return m_rules[i].get_name(); })};
+		if (it == m_by_name.end() || m_rules[*it].get_name() != name)
+			return -1;
+		return *it;
+	}
+
+	void request::set_parse_error(std::string_view msg, status s)
 	{
 		internals.errcode = -1;
 		internals.errmsg  = msg;
+		internals.errstatus = s;
 	}
 
-	bool request::parse_uri(line_reader& lr)
+	bool request::parse_uri(std::string_view line)
 	{
 		size_t nextpos{0};
-		std::string_view line = lr.getline();
 		if (auto newpos = line.find(" ", 0); newpos != std::string::npos) {
 			method = line.substr( 0, newpos );
 			nextpos = newpos;
@@ -455,6 +901,9 @@ namespace http
 			return false;
 		}
 
+		//HTTP/1.1 connections are persistent by default, HTTP/1.0 ones are not
+		response.set_keep_alive(!line.ends_with("HTTP/1.0"));
+
 		if (auto newpos = queryString.find("?", 0); newpos != std::string::npos) {
 			path = queryString.substr( 0,  newpos );
 		} else {
@@ -463,11 +912,13 @@ namespace http
 		return true;
 	}
 	
-	bool request::add_header(const std::string& header, const std::string& value)
+	bool request::add_header(std::string_view header, std::string_view value)
 	{
-		auto [iter, success] {headers.try_emplace(header, value)};
-		if (!success) {
-			set_parse_error(std::format("Bad request -> duplicated header {}", header));
+		if (!headers.add(payload.view(), header, value)) {
+			if (headers.full())
+				set_parse_error(std::format("Bad request -> more than {} headers", header_table::max_fields));
+			else
+				set_parse_error(std::format("Bad request -> duplicated header {}", header));
 			return false;
 		}
 		return true;
@@ -476,33 +927,21 @@ namespace http
 	bool request::set_content_length(std::string_view value)
 	{
 		constexpr auto msg {"Bad request -> invalid content length header: {} value: {}"};
-		try {
-			const std::string v {value};
-			internals.contentLength = std::stoul(v);
-		} catch (const std::invalid_argument& e) {
-			set_parse_error(std::format(msg, e.what(), value));
-			return false;			
-		} catch (const std::out_of_range& e) {
-			set_parse_error(std::format(msg, e.what(), value));
-			return false;	
+		const auto [ptr, ec] {std::from_chars(value.data(), value.data() + value.size(), internals.contentLength)};
+		if (ec != std::errc() || ptr != value.data() + value.size()) {
+			set_parse_error(std::format(msg, std::make_error_code(ec == std::errc() ? std::errc::invalid_argument : ec).message(), value));
+			return false;
 		}
 		return true;
 	}
 	
-	std::pair<std::string, std::string> request::split_header_line(std::string_view line)
-	{
-		auto newpos = line.find(":", 0); 
-		std::string header_name {lowercase(line.substr( 0,  newpos))};
-		std::string header_value {line.substr(newpos + 2,  line.size() - newpos + 2)};
-		return std::make_pair(header_name, header_value);
-	}
-	
 	bool request::parse_read_boundary(std::string_view value) 
 	{
 		isMultipart = false;
-		if (value.contains("=")) {
+		if (const auto b {disposition_param(value, "boundary")}; !b.empty()) {
 			isMultipart = true;
-			boundary = value.substr(value.find("=") + 1);
+			boundary = b;
+			form.start(boundary);
 			return true;
 		} else {
 			set_parse_error("Bad request -> invalid multipart value, cannot read boundary");
@@ -510,70 +949,115 @@ namespace http
 		}
 	}
 	
-	bool request::validate_header(std::string_view header, std::string_view value)
+	//pre-resolved headers the server acts upon, after all of them were parsed
+	bool request::validate_headers()
 	{
-		if (header == "content-length" && !set_content_length(value)) 
+		using enum header_table::known;
+		if (headers.contains(transfer_encoding)) {
+			//a message with both could be framed differently by a proxy in front of us (request smuggling)
+			if (headers.contains(content_length)) {
+				set_parse_error("Bad request -> both Transfer-Encoding and Content-Length headers");
+				return false;
+			}
+			//chunked must be the final coding, and it's the only one supported
+			if (const auto te {get_header(transfer_encoding)}; te.size() != 7 || !iequals(te, "chunked")) {
+				set_parse_error(std::format("Bad request -> unsupported Transfer-Encoding: {}", te));
+				return false;
+			}
+			internals.chunked = true;
+		}
+
+		if (headers.contains(content_length) && !set_content_length(get_header(content_length))) 
 			return false;
 					
-		if (header == "content-type" && value.starts_with("multipart") && !parse_read_boundary(value)) 
+		if (const auto value {get_header(content_type)}; value.starts_with("multipart") && !parse_read_boundary(value)) 
 			return false;
 					
-		if (header == "authorization" && value.starts_with("Bearer"))
+		if (const auto value {get_header(authorization)}; value.starts_with("Bearer"))
 			token = value.substr(value.find(" ") + 1);
 
-		if (header == "x-forwarded-for")
-			remote_ip = value;					
+		if (headers.contains(x_forwarded_for))
+			remote_ip = get_header(x_forwarded_for);
 
-		if (header == "origin") 
-			origin = value.empty() ? "null":  value;
+		if (headers.contains(origin)) 
+			this->origin = get_header(origin).empty() ? "null" : get_header(origin);
 	
 		return true;
 	}	
 	
-	bool request::parse_headers(line_reader& lr)
-	{
-		while (!lr.eof()) {
-			std::string_view line {lr.getline()};
-			if (line.size()==0) break;
-			
-			if (!line.contains(": ")) {
-				set_parse_error("Bad request -> invalid header format, header lacks ':'");
-				return false;
-			}
-			
-			auto [header, value] {split_header_line(line)};
-			if (!add_header(header, value))
-				return false;
-	
-			if (!validate_header(header, value))
-				return false;
+	bool request::parse_header_line(std::string_view line)
+	{
+		const auto colon {line.find(':')};
+		//no whitespace allowed between the field name and the colon (RFC 9112 5.1)
+		if (colon == std::string_view::npos || colon == 0 || line[colon - 1] == ' ' || line[colon - 1] == '\t') {
+			set_parse_error("Bad request -> invalid header format, header lacks ':'");
+			return false;
 		}
-		return true;
+		return add_header(line.substr(0, colon), trim_ows(line.substr(colon + 1)));
 	}
 	
-	void request::parse() 
+	//resumable: complete lines are consumed as they arrive and the position is kept between reads,
+	//returns true when the header block is complete or on error (internals.errcode is set)
+	bool request::parse() 
 	{
-		std::string_view str{payload.view()};
-		internals.bodyStartPos = str.find("\r\n\r\n", 0) + 4;
-		line_reader lr(str.substr(0, internals.bodyStartPos));
-	
-		if (internals.bodyStartPos <= 4) {
-			set_parse_error("Bad request -> no proper HTTP request found");
-			return;
+		if (internals.state == parse_state::request_line && internals.parsePos == 0 && remote_ip.empty()) {
+			//IPv4 text fits in the SSO buffer, no allocation, x-forwarded-for replaces it if present
+			std::array<char, INET_ADDRSTRLEN> ip{};
+			remote_ip = inet_ntop(AF_INET, &peer_addr.sin_addr, ip.data(), ip.size()) ? ip.data() : "";
 		}
-	
-		if (!parse_uri(lr))
-			return;
 
-		if (!parse_headers(lr))
+		const std::string_view str{payload.view()};
+		const size_t max_size {env::max_header_size()};
+		while (internals.state != parse_state::body) {
+			const auto eol {scan::find(str, "\r\n", internals.scanPos)};
+			if (eol == std::string_view::npos) {
+				if (str.size() > max_size) {
+					set_parse_error(std::format("Request header fields too large -> more than {} bytes", max_size), status::request_header_fields_too_large);
+					return true;
+				}
+				//only the last byte may be the start of a CRLF split between two reads
+				internals.scanPos = std::max(internals.parsePos, str.empty() ? 0 : str.size() - 1);
+				return false;
+			}
+			if (eol > max_size) {
+				set_parse_error(std::format("Request header fields too large -> more than {} bytes", max_size), status::request_header_fields_too_large);
+				return true;
+			}
+			const std::string_view line {str.substr(internals.parsePos, eol - internals.parsePos)};
+			internals.parsePos = eol + 2;
+			internals.scanPos = internals.parsePos;
+
+			if (internals.state == parse_state::request_line) {
+				//empty lines before the request line are ignored (RFC 9112 2.2)
+				if (line.empty())
+					continue;
+				if (!parse_uri(line))
+					return true;
+				internals.state = parse_state::headers;
+			} else if (line.empty()) {
+				internals.bodyStartPos = internals.parsePos;
+				internals.state = parse_state::body;
+			} else if (!parse_header_line(line)) {
+				return true;
+			}
+		}
+		finish_headers();
+		return true;
+	}
+
+	void request::finish_headers()
+	{
+		if (!validate_headers())
 			return;
 
-		if (internals.contentLength <= 0 && method == "POST") {
+		if (internals.chunked)
+			internals.rawPos = internals.bodyStartPos;
+		else if (internals.contentLength <= 0 && method == "POST") {
 			set_parse_error(std::format("Bad request -> invalid content length: {}", internals.contentLength));
 			return;
 		}
 		
-		if (method=="POST" && !isMultipart && get_header("content-type") != "application/json") {
+		if (method=="POST" && !isMultipart && get_header(header_table::known::content_type) != "application/json") {
 			set_parse_error("Bad request -> POST supported for multipart/form-data and JSON only with a valid content-length header");
 			return;
 		}
@@ -581,111 +1065,551 @@ namespace http
 		if (method == "GET" && !queryString.empty() && queryString.contains("?"))
 			parse_query_string(queryString);
 		
+		if (const auto conn {get_header(header_table::known::connection)}; icontains(conn, "close"))
+			response.set_keep_alive(false);
+		else if (icontains(conn, "keep-alive"))
+			response.set_keep_alive(true);
+
 		response.set_origin(origin);
-		response.set_request_id(get_header("x-request-id"));
+		response.set_request_id(get_header(header_table::known::x_request_id));
+		response.set_accept_encoding(negotiate_encoding(get_header(header_table::known::accept_encoding)));
 	}
 	
-	void request::parse_form() 
+	bool param_store::try_emplace(std::string_view name, std::string_view value)
+	{
+		const size_t name_pos {m_arena.size()};
+		m_arena.append(name);
+		const size_t value_pos {m_arena.size()};
+		m_arena.append(value);
+		return insert(name_pos, value_pos);
+	}
+
+	bool param_store::try_emplace_urlencoded(std::string_view name, std::string_view value)
+	{
+		const size_t name_pos {m_arena.size()};
+		url_decode_append(m_arena, name);
+		const size_t value_pos {m_arena.size()};
+		url_decode_append(m_arena, value);
+		return insert(name_pos, value_pos);
+	}
+
+	//the name and the value were just appended to the arena, they are dropped again if the name is repeated
+	bool param_store::insert(size_t name_pos, size_t value_pos)
+	{
+		const std::string_view name {std::string_view{m_arena}.substr(name_pos, value_pos - name_pos)};
+		const auto it {lower_bound(name)};
+		if (it != m_entries.end() && view(it->name_pos, it->name_len) == name) {
+			m_arena.resize(name_pos);
+			return false;
+		}
+		m_entries.insert(it, entry {
+			static_cast<uint32_t>(name_pos), static_cast<uint32_t>(value_pos - name_pos),
+			static_cast<uint32_t>(value_pos), static_cast<uint32_t>(m_arena.size() - value_pos)
+		});
+		return true;
+	}
+
+	void param_store::set(std::string_view name, std::string_view value)
 	{
-		auto fields = parse_multipart(this);
-		for (auto& f: fields) {
-			if (f.filename.empty()) {
-				params.try_emplace(f.name, f.data);
-			} else {
-				std::string file_uuid {get_uuid()};
-				std::string save_path {blob_path + file_uuid};
-				params.try_emplace( f.name + ".content_len", std::to_string( f.data.size() ) );
-				params.try_emplace( f.name + ".content_type", f.content_type);
-				params.try_emplace( f.name + ".document", file_uuid);
-				params.try_emplace( f.name + ".filename", f.filename);
-				if (auto [result, errdesc] {save_blob(save_path, f.data)}; !result)
-					throw http::invalid_payload_exception(errdesc);
+		const auto it {lower_bound(name)};
+		if (it == m_entries.end() || view(it->name_pos, it->name_len) != name) {
+			try_emplace(name, value);
+			return;
+		}
+		//the old value stays in the arena until clear()
+		const auto idx {static_cast<size_t>(it - m_entries.begin())};
+		const size_t value_pos {m_arena.size()};
+		m_arena.append(value);
+		m_entries[idx].value_pos = static_cast<uint32_t>(value_pos);
+		m_entries[idx].value_len = static_cast<uint32_t>(value.size());
+	}
+
+	std::string_view param_store::get(std::string_view name) const noexcept
+	{
+		if (const auto it {lower_bound(name)}; it != m_entries.end() && view(it->name_pos, it->name_len) == name)
+			return view(it->value_pos, it->value_len);
+		return "";
+	}
+
+	bool param_store::contains(std::string_view name) const noexcept
+	{
+		const auto it {lower_bound(name)};
+		return it != m_entries.end() && view(it->name_pos, it->name_len) == name;
+	}
+
+	std::vector<param_store::entry>::const_iterator param_store::lower_bound(std::string_view name) const noexcept
+	{
+		return std::ranges::lower_bound(m_entries, name, std::less<>{}, [this](const entry& e) { return view(e.name_pos, e.name_len); });
+	}
+
+	size_t param_store::size() const noexcept
+	{
+		return m_entries.size();
+	}
+
+	bool param_store::empty() const noexcept
+	{
+		return m_entries.empty();
+	}
+
+	void param_store::clear() noexcept
+	{
+		m_arena.clear();
+		m_entries.clear();
+	}
+
+	multipart_decoder::~multipart_decoder()
+	{
+		reset();
+	}
+
+	void multipart_decoder::start(std::string_view boundary)
+	{
+		reset();
+		m_delim = std::format("\r\n--{}", boundary);
+	}
+
+	bool multipart_decoder::done() const noexcept
+	{
+		return m_state == state::epilogue;
+	}
+
+	void multipart_decoder::reset() noexcept
+	{
+		if (m_fd != -1)
+			close(m_fd);
+		m_fd = -1;
+		if (!done())
+			for (const auto& b: m_blobs)
+				unlink(b.c_str());
+		m_blobs.clear();
+		m_state = state::preamble;
+		m_name.clear();
+		m_filename.clear();
+		m_content_type.clear();
+		m_value.clear();
+		m_document.clear();
+		m_size = 0;
+		m_file = false;
+	}
+
+	size_t multipart_decoder::feed(std::string_view data, param_store& fields)
+	{
+		using enum state;
+		size_t pos {0};
+		while (pos < data.size()) {
+			const std::string_view str {data.substr(pos)};
+			switch (m_state) {
+				case preamble: {
+					//the body should start with the first boundary, anything before it is ignored
+					const std::string_view dash_boundary {std::string_view{m_delim}.substr(2)};
+					const auto next {scan::find(str, dash_boundary)};
+					if (next == std::string_view::npos)
+						return pos + (str.size() >= dash_boundary.size() ? str.size() - dash_boundary.size() + 1 : 0);
+					pos += next + dash_boundary.size();
+					m_state = delimiter;
+					break;
+				}
+				case delimiter:
+					if (str.size() < 2)
+						return pos;
+					if (str.starts_with("--"))
+						m_state = epilogue;
+					else if (str.starts_with("\r\n"))
+						m_state = part_headers;
+					else
+						throw invalid_payload_exception("Invalid multipart-form payload, boundary not followed by CRLF");
+					pos += 2;
+					break;
+				case part_headers: {
+					const auto end {scan::find(str, "\r\n\r\n")};
+					if (end == std::string_view::npos && str.starts_with("\r\n"))
+						throw invalid_payload_exception("Invalid multipart-form payload, part is empty!");
+					if (end == std::string_view::npos) {
+						if (str.size() > max_part_headers)
+							throw invalid_payload_exception("Invalid multipart-form payload, part headers too large");
+						return pos;
+					}
+					begin_part(str.substr(0, end), fields);
+					pos += end + 4;
+					m_state = part_data;
+					break;
+				}
+				case part_data: {
+					//keep what could be the beginning of a boundary split across reads
+					if (const auto next {scan::find(str, m_delim)}; next != std::string_view::npos) {
+						write_part(str.substr(0, next));
+						end_part(fields);
+						pos += next + m_delim.size();
+						m_state = delimiter;
+						break;
+					}
+					if (str.size() < m_delim.size())
+						return pos;
+					const size_t n {str.size() - m_delim.size() + 1};
+					write_part(str.substr(0, n));
+					pos += n;
+					return pos;
+				}
+				case epilogue:
+					return data.size();
 			}
 		}
+		return pos;
+	}
+
+	void multipart_decoder::begin_part(std::string_view part_headers, param_store& fields)
+	{
+		std::string_view disposition;
+		for (const auto& l: std::views::split(part_headers, std::string_view{"\r\n"})) {
+			const std::string_view line {l.begin(), l.end()};
+			const auto colon {line.find(':')};
+			if (colon == std::string_view::npos)
+				continue;
+			const auto name {line.substr(0, colon)};
+			if (iequals(name, "content-disposition"))
+				disposition = trim_ows(line.substr(colon + 1));
+			else if (iequals(name, "content-type"))
+				m_content_type = trim_ows(line.substr(colon + 1));
+		}
+		m_name = disposition_param(disposition, "name");
+		m_filename = disposition_param(disposition, "filename");
+		if (m_name.empty())
+			throw invalid_payload_exception("Invalid multipart-form payload, part without a field name");
+		m_file = !m_filename.empty();
+		m_size = 0;
+		//the first part with a given name wins, the data of a repeated file field is dropped
+		if (!m_file || fields.contains(m_name + ".document"))
+			return;
+		m_document = get_uuid();
+		const std::string save_path {blob_path + m_document};
+		m_fd = open(save_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (m_fd == -1)
+			throw invalid_payload_exception(std::format("save_blob() failed: {}", std::strerror(errno)));
+		m_blobs.push_back(save_path);
+		fields.try_emplace(m_name + ".document", m_document);
+	}
+
+	void multipart_decoder::write_part(std::string_view data)
+	{
+		if (!m_file) {
+			if (m_value.size() + data.size() > max_text_field)
+				throw invalid_payload_exception(std::format("Invalid multipart-form payload, field {} is too large", m_name));
+			m_value.append(data);
+			return;
+		}
+		m_size += data.size();
+		while (m_fd != -1 && !data.empty()) {
+			const auto n {::write(m_fd, data.data(), data.size())};
+			if (n == -1 && errno == EINTR)
+				continue;
+			if (n == -1)
+				throw invalid_payload_exception(std::format("save_blob() failed saving content: {}", std::strerror(errno)));
+			data.remove_prefix(static_cast<size_t>(n));
+		}
+	}
+
+	void multipart_decoder::end_part(param_store& fields)
+	{
+		if (!m_file) {
+			fields.try_emplace(m_name, m_value);
+		} else if (m_fd != -1) {
+			const int rc {close(m_fd)};
+			m_fd = -1;
+			if (rc == -1)
+				throw invalid_payload_exception(std::format("save_blob() failed saving content: {}", std::strerror(errno)));
+			fields.try_emplace(m_name + ".content_len", std::to_string(m_size));
+			fields.try_emplace(m_name + ".content_type", m_content_type);
+			fields.try_emplace(m_name + ".filename", m_filename);
+		}
+		m_name.clear();
+		m_filename.clear();
+		m_content_type.clear();
+		m_value.clear();
+		m_document.clear();
+		m_file = false;
+	}
+
+	//streams the body received so far into the multipart decoder, the decoded bytes are removed from the buffer
+	//so an upload only ever holds about one read in memory
+	void request::parse_form() 
+	{
+		const size_t end {body_end()};
+		const std::string_view body {payload.view().substr(internals.bodyStartPos, end - internals.bodyStartPos)};
+		const size_t n {form.feed(body, params)};
+		if (n == 0)
+			return;
+		payload.erase(internals.bodyStartPos, internals.bodyStartPos + n);
+		internals.bodyConsumed += n;
+		if (internals.chunked)
+			internals.rawPos -= n;
 	}
 	
 	bool request::eof() 
 	{
-		if ( (payload.size() - internals.bodyStartPos) == internals.contentLength ) {
-			if (method == "POST" && isMultipart) {
-				try {
-					parse_form();
-				} catch (const invalid_payload_exception& e) {
-					set_parse_error(e.what());
+		const bool complete {internals.chunked ? decode_chunked() : payload.size() - internals.bodyStartPos + internals.bodyConsumed >= internals.contentLength};
+		if (internals.errcode)
+			return true;
+		if (method == "POST" && isMultipart) {
+			try {
+				parse_form();
+				if (complete && !form.done())
+					throw invalid_payload_exception("Invalid multipart-form payload, closing boundary not found");
+			} catch (const invalid_payload_exception& e) {
+				set_parse_error(e.what());
+				return true;
+			}
+			return complete;
+		}
+		if (!complete)
+			return false;
+		if (method == "POST" && get_header(header_table::known::content_type).ends_with("/json")) {
+			try {
+				parse_json(this);
+			} catch (const json::parsing_error& e) {
+				set_parse_error(e.what());
+			}
+		}
+		return true;
+	}
+
+	//end of the part of the body still in the buffer, for a chunked body only the decoded part
+	size_t request::body_end() const noexcept
+	{
+		const size_t end {internals.bodyStartPos + internals.contentLength - internals.bodyConsumed};
+		return internals.chunked ? end : std::min(end, static_cast<size_t>(payload.size()));
+	}
+		
+	//decodes the chunks received so far in place, the decoded body starts at bodyStartPos like a Content-Length one,
+	//returns true when the last chunk and the trailers were read or on error
+	bool request::decode_chunked()
+	{
+		using enum chunk_state;
+		constexpr size_t max_line {4096};
+		//without a configured limit the body still has to fit in a buffer
+		const size_t limit {internals.maxBodySize ? internals.maxBodySize : static_cast<size_t>(std::numeric_limits<std::ptrdiff_t>::max())};
+		char* buf {payload.begin()};
+		while (internals.chunkState != done) {
+			const std::string_view str {payload.view()};
+			switch (internals.chunkState) {
+				case size_line: {
+					const auto eol {scan::find(str, "\r\n", internals.rawPos)};
+					if (eol == std::string_view::npos) {
+						if (str.size() - internals.rawPos > max_line) {
+							set_parse_error("Bad request -> chunk size line too long");
+							return true;
+						}
+						return false;
+					}
+					//chunk extensions after ';' are ignored
+					auto line {str.substr(internals.rawPos, eol - internals.rawPos)};
+					line = trim_ows(line.substr(0, line.find(';')));
+					size_t size {0};
+					if (const auto [ptr, ec] {std::from_chars(line.data(), line.data() + line.size(), size, 16)}; line.empty() || ec != std::errc() || ptr != line.data() + line.size()) {
+						set_parse_error(std::format("Bad request -> invalid chunk size: {}", line));
+						return true;
+					}
+					//written as a subtraction, a huge size must not wrap around the sum
+					if (internals.contentLength > limit || size > limit - internals.contentLength) {
+						set_parse_error(std::format("Payload too large -> chunked body exceeds the limit of {} bytes", limit), status::payload_too_large);
+						return true;
+					}
+					internals.rawPos = eol + 2;
+					internals.chunkRemaining = size;
+					internals.chunkState = size ? data : trailers;
+					break;
 				}
-			} else if (method == "POST" && get_header("content-type").ends_with("/json")) {
-				try {
-					parse_json(this);
-				} catch (const json::parsing_error& e) {
-					set_parse_error(e.what());
+				case data: {
+					const size_t n {std::min(str.size() - internals.rawPos, internals.chunkRemaining)};
+					std::memmove(buf + body_end(), buf + internals.rawPos, n);
+					internals.contentLength += n;
+					internals.rawPos += n;
+					internals.chunkRemaining -= n;
+					if (internals.chunkRemaining)
+						return false;
+					internals.chunkState = data_crlf;
+					break;
 				}
+				case data_crlf:
+					if (str.size() - internals.rawPos < 2)
+						return false;
+					if (str.substr(internals.rawPos, 2) != "\r\n") {
+						set_parse_error("Bad request -> chunk data not followed by CRLF");
+						return true;
+					}
+					internals.rawPos += 2;
+					internals.chunkState = size_line;
+					break;
+				case trailers: {
+					//trailer fields are read and discarded, an empty line ends the message; bounded like the headers
+					const auto eol {scan::find(str, "\r\n", internals.rawPos)};
+					const size_t line_size {(eol == std::string_view::npos ? str.size() : eol + 2) - internals.rawPos};
+					if (line_size > max_line || internals.trailerSize + line_size > env::max_header_size()) {
+						set_parse_error("Request header fields too large -> chunked trailer too long", status::request_header_fields_too_large);
+						return true;
+					}
+					if (eol == std::string_view::npos)
+						return false;
+					internals.trailerSize += line_size;
+					internals.chunkState = eol == internals.rawPos ? done : trailers;
+					internals.rawPos = eol + 2;
+					break;
+				}
+				case done:
+					break;
 			}
-			return true;
 		}
-		else
+		//close the gap left by the chunk framing, pipelined bytes now follow the decoded body
+		payload.erase(body_end(), internals.rawPos);
+		internals.rawPos = body_end();
+		return true;
+	}
+
+	bool request::expects_continue() const noexcept
+	{
+		return icontains(get_header(header_table::known::expect), "100-continue");
+	}
+
+	bool request::limit_body(size_t max_bytes)
+	{
+		//an upload is streamed to disk, a few reads worth of buffer is all it needs;
+		//other bodies are presized up to 1 MB and grow as they arrive, headers alone can't make the server commit more
+		constexpr size_t upload_buffer_size {65536};
+		constexpr size_t presize_limit {1048576};
+		internals.maxBodySize = max_bytes;
+		if (max_bytes && internals.contentLength > max_bytes) {
+			set_parse_error(std::format("Payload too large -> Content-Length {} exceeds the limit of {} bytes", internals.contentLength, max_bytes), status::payload_too_large);
+			return false;
+		}
+		try {
+			payload.reserve(internals.bodyStartPos + std::min(internals.contentLength, isMultipart ? upload_buffer_size : presize_limit));
+		} catch (const std::bad_alloc&) {
+			set_parse_error("Payload too large -> out of memory presizing the request buffer", status::payload_too_large);
 			return false;
+		}
+		return true;
 	}
-		
-	std::string request::get_header(const std::string& name) const 
+
+	void request::reject(status s, std::string_view msg)
 	{
-		if (auto value = headers.find(name); value != headers.end()) 
-			return value->second;
-		else
-			return "";
+		set_parse_error(msg, s);
+	}
+
+	std::string_view request::get_header(std::string_view name) const noexcept
+	{
+		return headers.get(payload.view(), name);
+	}
+
+	std::string_view request::get_header(header_table::known k) const noexcept
+	{
+		return headers.get(payload.view(), k);
+	}
+
+	bool header_table::add(std::string_view buffer, std::string_view name, std::string_view value) noexcept
+	{
+		if (m_size == max_fields)
+			return false;
+		const size_t slot {find_slot(buffer, name)};
+		if (m_index[slot])
+			return false;
+		m_fields[m_size] = field {
+			static_cast<uint32_t>(name.data() - buffer.data()), static_cast<uint32_t>(name.size()),
+			static_cast<uint32_t>(value.data() - buffer.data()), static_cast<uint32_t>(value.size())
+		};
+		++m_size;
+		m_index[slot] = static_cast<uint8_t>(m_size);
+		if (const int k {known_header_index(name)}; k >= 0)
+			m_known[k] = static_cast<uint8_t>(m_size);
+		return true;
+	}
+
+	std::string_view header_table::get(std::string_view buffer, std::string_view name) const noexcept
+	{
+		if (const int k {known_header_index(name)}; k >= 0)
+			return get(buffer, static_cast<known>(k));
+		if (const auto idx {m_index[find_slot(buffer, name)]}; idx)
+			return value(buffer, m_fields[idx - 1]);
+		return "";
+	}
+
+	//linear probing, the table is never more than half full so the probe ends at an empty slot
+	size_t header_table::find_slot(std::string_view buffer, std::string_view name) const noexcept
+	{
+		for (size_t slot {header_name_hash(name) & (slots - 1)};; slot = (slot + 1) & (slots - 1)) {
+			const auto idx {m_index[slot]};
+			if (!idx)
+				return slot;
+			if (const auto n {this->name(buffer, m_fields[idx - 1])}; n.size() == name.size() && iequals(n, name))
+				return slot;
+		}
+	}
+
+	std::string_view header_table::get(std::string_view buffer, known k) const noexcept
+	{
+		if (const auto idx {m_known[static_cast<size_t>(k)]}; idx)
+			return value(buffer, m_fields[idx - 1]);
+		return "";
+	}
+
+	bool header_table::contains(known k) const noexcept
+	{
+		return m_known[static_cast<size_t>(k)] != 0;
+	}
+
+	size_t header_table::size() const noexcept
+	{
+		return m_size;
+	}
+
+	bool header_table::full() const noexcept
+	{
+		return m_size == max_fields;
+	}
+
+	void header_table::clear() noexcept
+	{
+		if (m_size)
+			m_index.fill(0);
+		m_size = 0;
+		m_known.fill(0);
+	}
+
+	std::string_view header_table::name(std::string_view buffer, const field& f) const noexcept
+	{
+		return buffer.substr(f.name_pos, f.name_len);
+	}
+
+	std::string_view header_table::value(std::string_view buffer, const field& f) const noexcept
+	{
+		return buffer.substr(f.value_pos, f.value_len);
 	}
 	
 	std::string request::get_param(const std::string& name) const 
 	{
-		if (auto value = params.find(name); value != params.end()) 
-			return value->second;
-		else
-			return "";
-	}
-
-	//using while-loop and iterator to be compliant with Sonar rule cpp:S886
-	constexpr std::string request::decode_param(std::string_view encoded_string) const noexcept
-	{
-		std::string decoded_string;
-		auto it {std::begin(encoded_string)};
-		auto end {std::end(encoded_string)};
-		while (it != end) {
-			if (*it == '%' && it + 2 < end) {
-                const std::array<char, 3> str {*std::next(it, 1), *std::next(it, 2), 0};
-                decoded_string += static_cast<char>(std::strtol(str.data(), nullptr, 16));
-				std::advance(it, 3);
-			} else {
-				decoded_string += *it;
-				std::advance(it, 1);
-			}
-		}
-		return decoded_string;
+		return std::string{params.get(name)};
 	}
 
 	void request::parse_param(std::string_view param) noexcept 
 	{
-		if (auto pos {param.find("=")}; pos != std::string::npos) {
-			std::string_view name {param.substr(0, pos)};
-			std::string_view value {param.substr(pos + 1, param.size() - pos)};
-			if (value.contains("%"))
-				params.try_emplace(std::string{name}, decode_param(value));
-			else
-				params.try_emplace(std::string{name}, value);
-		}		
+		if (auto pos {param.find('=')}; pos != std::string_view::npos)
+			params.try_emplace_urlencoded(param.substr(0, pos), param.substr(pos + 1));
 	}
 
 	void request::parse_query_string(std::string_view qs) noexcept 
 	{
-		auto pos {qs.find("?")};
-		std::string_view query_string = qs.substr(pos + 1);
-		constexpr std::string_view delim{"&"};
-		for (const auto& word : std::views::split(query_string, delim)) {
-			parse_param(std::string_view{word});
+		std::string_view query_string {qs.substr(qs.find('?') + 1)};
+		while (!query_string.empty()) {
+			const auto amp {query_string.find('&')};
+			parse_param(query_string.substr(0, amp));
+			if (amp == std::string_view::npos)
+				break;
+			query_string.remove_prefix(amp + 1);
 		}
 	}
 
 	std::string request::get_sql(std::string sql)
 	{
-		if (input_rules.empty())
+		if (!input_rules || input_rules->empty())
 			return sql;
 		const std::string userlogin_marker{"$userlogin"};
 		if (std::size_t pos = sql.find(userlogin_marker); pos != std::string::npos)
@@ -693,10 +1617,10 @@ namespace http
 		const std::string sessionid_marker{"$sessionid"};
 		if (std::size_t pos = sql.find(sessionid_marker); pos != std::string::npos)
 			sql.replace(pos, sessionid_marker.size(), "'" + user_info.sessionid + "'");
-		for (const auto& p:input_rules)
+		for (const auto& p:input_rules->rules())
 		{
 			std::string name {"$" + p.get_name()};
-			const auto& value = params[p.get_name()];
+			const auto value {params.get(p.get_name())};
 			if (std::size_t pos = sql.find(name); pos != std::string::npos) {
 				if (value.empty()) {
 					sql.replace(pos, name.length(), "NULL");
@@ -708,7 +1632,7 @@ namespace http
 						sql.replace(pos, name.length(), value);
 						break;
 					default:
-						sql.replace(pos, name.length(), "'" + value + "'");
+						sql.replace(pos, name.length(), std::format("'{}'", value));
 				}
 			}
 		}
@@ -736,7 +1660,7 @@ namespace http
 
 	void request::log(std::string_view source, std::string_view level, const std::string& msg) noexcept
 	{
-		logger::log(source, level, replace_params(this, msg), get_header("x-request-id"));
+		logger::log(source, level, replace_params(this, msg), get_header(header_table::known::x_request_id));
 	}
 
 	void request::send_mail(const std::string& to, std::string& subject, const std::string& body)
@@ -759,7 +1683,7 @@ namespace http
 	{
 		auto mail_to = to;
 		auto mail_body {get_mail_body(this, body)};
-		auto x_request_id {get_header("x-request-id")};
+		std::string x_request_id {get_header(header_table::known::x_request_id)};
 		util::async_launch("Sending email...", 
 			[
 				to_ = std::move(mail_to), cc_ = std::move(cc), subject_ = std::move(subject), body_ = std::move(mail_body), 
@@ -784,10 +1708,17 @@ namespace http
 		);
 	}
 
+	//a multipart body is streamed to disk as it arrives, only its bytes not decoded yet remain in the buffer
 	std::string_view request::get_body() const noexcept
 	{
 		std::string_view body {payload.view()};
-		return body.substr(internals.bodyStartPos);
+		return body.substr(internals.bodyStartPos, internals.contentLength - internals.bodyConsumed);
+	}
+
+	//the buffer may also hold the beginning of a pipelined request
+	size_t request::message_size() const noexcept
+	{
+		return internals.bodyStartPos + internals.contentLength - internals.bodyConsumed;
 	}
 
 }
@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <fstream>
 #include <vector>
+#include <memory>
 #include <sstream>
 #include <cerrno>
 #include <cstring>
@@ -27,12 +28,16 @@
 #include <charconv>
 #include <chrono>
 #include <utility>
+#include <variant>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
 #include <uuid/uuid.h>
 #include "util.h"
 #include "logger.h"
 #include "jwt.h"
 #include "email.h"
+#include "router.h"
 
 namespace http
 {
@@ -45,7 +50,9 @@ namespace http
         unauthorized = 401,
         forbidden = 403,
         not_found = 404,
-        method_not_allowed = 405
+        method_not_allowed = 405,
+        payload_too_large = 413,
+        request_header_fields_too_large = 431
     };
 	
 	inline std::ostream& operator<<(std::ostream& os, status s) {
@@ -59,6 +66,8 @@ namespace http
 			case forbidden:          return os << "403"sv;
 			case not_found:          return os << "404"sv;
 			case method_not_allowed: return os << "405"sv;
+			case payload_too_large:  return os << "413"sv;
+			case request_header_fields_too_large: return os << "431"sv;
 			default: return os << "Unknown Status";
 		}
 	}
@@ -168,7 +177,7 @@ namespace http
 	struct input_rule {
 		public:
 			input_rule(const std::string& n, field_type d, bool r) noexcept: name{n}, datatype{d}, required{r} {  }
-			auto get_name() const {return name;}
+			const std::string& get_name() const noexcept {return name;}
 			auto get_type() const {return datatype;}
 			auto get_required() const {return required;}
 		private:
@@ -177,46 +186,223 @@ namespace http
 			bool required;
 	};
 	
-	struct form_field 
-	{
-		std::string name;
-		std::string filename;
-		std::string content_type;
-		std::string data;
+	/**
+	 * @brief The input rules of an API, compiled once when it is registered.
+	 *
+	 * request::enforce() runs the plan with a single pass over each field that trims, validates, escapes
+	 * and converts it; requests point to the plan of their API instead of copying its rules.
+	 */
+	class validation_plan {
+	  public:
+		validation_plan() = default;
+		explicit validation_plan(std::vector<input_rule> rules);
+		const std::vector<input_rule>& rules() const noexcept { return m_rules; }
+		bool empty() const noexcept { return m_rules.empty(); }
+		//index of the rule of a field, -1 if the API does not declare it
+		int find(std::string_view name) const noexcept;
+	  private:
+		std::vector<input_rule> m_rules;
+		std::vector<uint16_t> m_by_name; //rule indexes sorted by name
+	};
+
+	//typed value of a validated INTEGER, DOUBLE or DATE field, std::monostate for strings and empty fields
+	using param_value = std::variant<std::monostate, int, double, std::chrono::year_month_day>;
+
+	/**
+	 * @brief Request parameters (query string, JSON or multipart fields) in a flat sorted vector.
+	 *
+	 * Names and values are copied, or percent-decoded, into one arena string, the entries are offsets into it
+	 * kept sorted by name for binary search. clear() keeps both buffers, so a persistent connection parses its
+	 * parameters without allocating. Views returned by get() are valid until the store is modified.
+	 */
+	class param_store {
+	  public:
+		//the first value of a name wins, returns false for a repeated name
+		bool try_emplace(std::string_view name, std::string_view value);
+		//same, name and value are percent-decoded straight into the arena ('+' is a space)
+		bool try_emplace_urlencoded(std::string_view name, std::string_view value);
+		//replaces the value, adds the parameter if absent
+		void set(std::string_view name, std::string_view value);
+		//replaces the value of an existing parameter in one pass: fn(value, arena) appends at most max_size bytes,
+		//the new value, to the arena; returns false if the parameter is absent
+		template<typename Fn>
+		bool rewrite(std::string_view name, size_t max_size, Fn&& fn)
+		{
+			const auto it {lower_bound(name)};
+			if (it == m_entries.end() || view(it->name_pos, it->name_len) != name)
+				return false;
+			auto& e {m_entries[static_cast<size_t>(it - m_entries.begin())]};
+			m_arena.reserve(m_arena.size() + max_size); //the old value stays valid while fn appends
+			const size_t value_pos {m_arena.size()};
+			fn(view(e.value_pos, e.value_len), m_arena);
+			e.value_pos = static_cast<uint32_t>(value_pos);
+			e.value_len = static_cast<uint32_t>(m_arena.size() - value_pos);
+			return true;
+		}
+		std::string_view get(std::string_view name) const noexcept;
+		bool contains(std::string_view name) const noexcept;
+		size_t size() const noexcept;
+		bool empty() const noexcept;
+		void clear() noexcept;
+
+		//(name, value) pairs sorted by name
+		auto items() const noexcept
+		{
+			return m_entries | std::views::transform([this](const entry& e) {
+				return std::pair{view(e.name_pos, e.name_len), view(e.value_pos, e.value_len)};
+			});
+		}
+
+	  private:
+		struct entry {
+			uint32_t name_pos;
+			uint32_t name_len;
+			uint32_t value_pos;
+			uint32_t value_len;
+		};
+		std::string_view view(uint32_t pos, uint32_t len) const noexcept
+		{
+			return std::string_view{m_arena}.substr(pos, len);
+		}
+		std::vector<entry>::const_iterator lower_bound(std::string_view name) const noexcept;
+		bool insert(size_t name_pos, size_t value_pos);
+
+		std::string m_arena;
+		std::vector<entry> m_entries;
+	};
+
+	/**
+	 * @brief Incremental multipart/form-data decoder.
+	 *
+	 * Fed with the body as it arrives, file parts are written to blob_path while they are received and
+	 * only text fields are kept in memory, so the memory used by an upload does not depend on its size.
+	 * The fields are added with the same keys the buffered parser used: name for text fields and
+	 * name.document, name.filename, name.content_type, name.content_len for files.
+	 */
+	class multipart_decoder {
+	  public:
+		constexpr static size_t max_part_headers {8192};
+		constexpr static size_t max_text_field {1048576};
+
+		multipart_decoder() = default;
+		multipart_decoder(const multipart_decoder&) = delete;
+		multipart_decoder& operator=(const multipart_decoder&) = delete;
+		~multipart_decoder();
+
+		void start(std::string_view boundary);
+		//decodes as much of data as it can and returns the number of bytes consumed, the rest (an incomplete
+		//part header or what may be the beginning of a boundary) must be passed again followed by the next bytes,
+		//throws invalid_payload_exception
+		size_t feed(std::string_view data, param_store& fields);
+		bool done() const noexcept;
+		//closes the current blob, the blobs of an incomplete upload are deleted
+		void reset() noexcept;
+
+	  private:
+		enum class state : uint8_t {
+			preamble,
+			delimiter,
+			part_headers,
+			part_data,
+			epilogue
+		};
+		void begin_part(std::string_view part_headers, param_store& fields);
+		void write_part(std::string_view data);
+		void end_part(param_store& fields);
+
+		state m_state{state::preamble};
+		std::string m_delim; //CRLF "--" boundary, the first one may come without the CRLF
+		std::string m_name;
+		std::string m_filename;
+		std::string m_content_type;
+		std::string m_value;
+		std::string m_document;
+		size_t m_size{0};
+		int m_fd{-1};
+		bool m_file{false};
+		std::vector<std::string> m_blobs; //written by this upload, deleted if it does not complete
+	};
+
+	enum class parse_state : uint8_t {
+		request_line,
+		headers,
+		body
+	};
+
+	enum class chunk_state : uint8_t {
+		size_line,
+		data,
+		data_crlf,
+		trailers,
+		done
 	};
 
 	struct request_internals {
 		size_t bodyStartPos{0};
 		size_t contentLength{0};
+		size_t parsePos{0}; //start of the first line not consumed yet
+		size_t scanPos{0}; //bytes before this were already searched for CRLF
+		parse_state state{parse_state::request_line};
+		bool chunked{false}; //Transfer-Encoding: chunked, decoded in place, contentLength grows as chunks arrive
+		chunk_state chunkState{chunk_state::size_line};
+		size_t chunkRemaining{0};
+		size_t trailerSize{0}; //bytes of the trailer fields read so far
+		size_t rawPos{0}; //next encoded byte to decode
+		size_t bodyConsumed{0}; //body bytes already decoded and removed from the buffer (multipart uploads)
+		size_t maxBodySize{0}; //0 means no limit
 		int errcode{0};
+		status errstatus{status::bad_request};
 		std::string errmsg;
 	};
 
+	//receive buffer of a connection, it grows geometrically without zero-filling and can be presized
+	//from the Content-Length, so a large body is not copied over and over while it arrives;
+	//growing may throw std::bad_alloc, the server rejects the request
 	struct socket_buffer {
 	private:
-		constexpr static int _buffer_size {2048};
-		constexpr static double _threshold {0.75};
-		std::vector<char> _buffer;
+		constexpr static size_t _buffer_size {2048};
+		constexpr static size_t _max_retained {65536}; //larger buffers are released once the request is done
+		std::unique_ptr<char[]> _buffer {std::make_unique_for_overwrite<char[]>(_buffer_size)};
+		size_t _capacity{_buffer_size};
 		int _pos{0};
-	public:
-		socket_buffer() {
-			_buffer.resize(_buffer_size, 0);
+
+		void reallocate(size_t capacity) {
+			auto buf {std::make_unique_for_overwrite<char[]>(capacity)};
+			std::copy_n(_buffer.get(), _pos, buf.get());
+			_buffer = std::move(buf);
+			_capacity = capacity;
 		}
-		
-		constexpr void update_pos(int n) noexcept {
+	public:
+		void update_pos(int n) {
 			if ( n > 0) {
 				_pos += n;
-				if (_pos > int(double(_buffer.size()) * _threshold))
-					_buffer.resize(_buffer.size() + _buffer_size, 0);
+				if (static_cast<size_t>(_pos) > _capacity / 4 * 3)
+					reallocate(_capacity * 2);
+			}
+		}
+
+		//room for n bytes without growing again, the last read still leaves a free quarter
+		void reserve(size_t n) {
+			if (const size_t capacity {n / 3 * 4 + _buffer_size}; capacity > _capacity)
+				reallocate(capacity);
+		}
+
+		//copies data received elsewhere at the end, growing as needed
+		void append(std::string_view data) {
+			while (!data.empty()) {
+				const auto n {std::min(data.size(), static_cast<size_t>(available_size()))};
+				std::copy_n(data.data(), n, _buffer.get() + _pos);
+				data.remove_prefix(n);
+				update_pos(static_cast<int>(n));
 			}
 		}
 		
 		constexpr int available_size() const noexcept {
-			return int(_buffer.size() - _pos);
+			return int(_capacity - static_cast<size_t>(_pos));
 		}
 
 		constexpr auto buffer_size() const noexcept {
-			return _buffer.size();
+			return _capacity;
 		}
 
 		constexpr auto size() const noexcept {
@@ -224,89 +410,234 @@ namespace http
 		}
 
 		constexpr char* data() noexcept {
-			return &_buffer[_pos];
+			return _buffer.get() + _pos;
 		}
 		
 		constexpr std::string_view view() const noexcept {
-			return std::string_view{&_buffer[0], &_buffer[_pos]};
+			return std::string_view{_buffer.get(), static_cast<size_t>(_pos)};
+		}
+
+		constexpr char* begin() noexcept {
+			return _buffer.get();
+		}
+
+		//removes the bytes in [from, to), the rest is moved down
+		constexpr void erase(size_t from, size_t to) noexcept {
+			std::copy(_buffer.get() + to, _buffer.get() + _pos, _buffer.get() + from);
+			_pos -= int(to - from);
 		}
 		
 		constexpr bool empty() const noexcept {
 			return _pos == 0;
 		}
 		
-		constexpr void clear() noexcept {
+		void clear() noexcept {
 			_pos = 0;
-			_buffer.resize(_buffer_size, 0);
+			if (_capacity > _max_retained) {
+				_buffer = std::make_unique_for_overwrite<char[]>(_buffer_size);
+				_capacity = _buffer_size;
+			}
+		}
+
+		//drops the first n bytes, the rest is moved to the front
+		constexpr void discard(size_t n) noexcept {
+			std::copy(_buffer.get() + n, _buffer.get() + _pos, _buffer.get());
+			_pos -= int(n);
 		}
 	};
 
+	//content codings the server can apply to a response body, see negotiate_encoding()
+	enum class content_coding : uint8_t {
+		identity,
+		gzip,
+		deflate
+	};
+
+	//picks the coding from an Accept-Encoding header value, gzip is preferred on equal q-values
+	content_coding negotiate_encoding(std::string_view accept_encoding) noexcept;
+
+	//a complete 200 response kept by the response cache, replayed with fresh Date, CORS and Connection headers
+	struct response_snapshot {
+		std::shared_ptr<const std::string> body;
+		std::string content_type;
+		std::string etag; //empty if the API has no Cache-Control
+		std::string cache_control;
+		content_coding encoding {content_coding::identity};
+
+		//approximate memory held by the snapshot
+		size_t size() const noexcept { return sizeof(*this) + body->size() + content_type.size() + etag.size() + cache_control.size(); }
+	};
+
 	struct response_stream {
 	  public:	
 		response_stream();
 		response_stream& operator <<(std::string_view data);
 		void set_body(std::string_view body, std::string_view content_type = "application/json");
 		void set_body_blob(std::string_view body, std::string_view content_type);
+
+		//rvalue strings (i.e. sql::get_json_response_rs()) are moved in and sent without copying
+		template<typename T> requires std::same_as<T, std::string>
+		void set_body(T&& body, std::string_view content_type = "application/json")
+		{
+			_body = std::move(body);
+			format_headers(content_type, false);
+		}
+
+		template<typename T> requires std::same_as<T, std::string>
+		void set_body_blob(T&& body, std::string_view content_type)
+		{
+			_body = std::move(body);
+			format_headers(content_type, true);
+		}
+
 		void set_content_disposition(std::string_view disposition);
 		void set_origin(std::string_view origin);
 		void set_request_id(std::string_view req_id);
+		void set_keep_alive(bool keep_alive) noexcept;
+		void set_accept_encoding(content_coding coding) noexcept;
+		bool keep_alive() const noexcept;
+		//true if the body was set with set_body(), the client accepts a coding and the body has at least min_size bytes
+		bool compressible(size_t min_size) const noexcept;
+		//compresses the body with zlib at the given level and rewrites the headers, returns the bytes saved, 0 if left as is
+		size_t compress(int level);
+		//adds a weak ETag of the body and the given Cache-Control, or turns the response into a 304 if If-None-Match
+		//has that tag, returns true in that case
+		bool revalidate(std::string_view cache_control, std::string_view if_none_match);
+		//the response set with set_body() as a snapshot that can be replayed, nullptr for blobs and hand-built responses
+		std::shared_ptr<const response_snapshot> snapshot();
+		//sends a snapshot as this response, or a 304 if If-None-Match has its ETag
+		void replay(const std::shared_ptr<const response_snapshot>& s, std::string_view if_none_match);
+		std::string_view connection() const noexcept;
 		std::string_view view() const noexcept;
 		size_t size() const noexcept;
 		const char* data() const noexcept;
 		void clear() noexcept;
 		bool write(int fd) noexcept; 
+		std::array<std::string_view, 2> unsent() const noexcept;
+		size_t pending() const noexcept;
+		void consume(size_t n) noexcept;
 	  private:
-		int _pos1 {0};
-		std::string _buffer{""};
+		void format_headers(std::string_view content_type, bool blob);
+		void render_headers();
+		void format_not_modified(std::string_view etag);
+		std::string_view body_view() const noexcept;
+		constexpr static size_t _max_retained_body {65536};
+		constexpr static std::string_view default_cache_control {"no-store"};
+		size_t _pos1 {0};
+		size_t _headers_pos {0}; //where format_headers() started writing into _buffer
+		std::string _buffer{""}; //status line and headers, or a complete response written with <<
+		std::string _body{""};
+		std::shared_ptr<const std::string> _shared_body; //set instead of _body by snapshot() and replay()
 		std::string _content_disposition{""};
 		std::string _origin{""};
 		std::string _x_request_id{""};
+		std::string _content_type{""};
+		std::string _etag{""}; //weak ETag of the body, empty unless revalidate() was called
+		std::string _cache_control{default_cache_control};
+		bool _keep_alive{false};
+		bool _blob{false};
+		bool _formatted{false}; //the headers were written by set_body() or set_body_blob()
+		bool _compressible{false};
+		content_coding _accept_encoding{content_coding::identity};
+		content_coding _content_encoding{content_coding::identity};
 	};
 		
-	struct line_reader {
+	//request header fields stored as offsets into the socket buffer, which can be reallocated while the body is read,
+	//fixed capacity and no allocations, names are compared case-insensitive
+	class header_table {
 	  public:
-		explicit line_reader(std::string_view str);
-		bool eof() const noexcept;
-		std::string_view getline();
-		
+		//headers used by the server itself, resolved once while parsing with a compile-time perfect hash
+		enum class known : uint8_t {
+			content_length,
+			content_type,
+			authorization,
+			origin,
+			x_forwarded_for,
+			x_request_id,
+			connection,
+			transfer_encoding,
+			expect,
+			accept_encoding,
+			if_none_match,
+			count
+		};
+		constexpr static size_t max_fields {64};
+
+		//name and value must be views into buffer, returns false if the table is full or the header is duplicated
+		bool add(std::string_view buffer, std::string_view name, std::string_view value) noexcept;
+		std::string_view get(std::string_view buffer, std::string_view name) const noexcept;
+		std::string_view get(std::string_view buffer, known k) const noexcept;
+		bool contains(known k) const noexcept;
+		size_t size() const noexcept;
+		bool full() const noexcept;
+		void clear() noexcept;
+
 	  private:
-		bool _eof{false};
-		std::string_view buffer;
-		int pos{0};
-		const std::string line_sep{"\r\n"};
-	};	
-	
+		struct field {
+			uint32_t name_pos;
+			uint32_t name_len;
+			uint32_t value_pos;
+			uint32_t value_len;
+		};
+		std::string_view name(std::string_view buffer, const field& f) const noexcept;
+		std::string_view value(std::string_view buffer, const field& f) const noexcept;
+		size_t find_slot(std::string_view buffer, std::string_view name) const noexcept;
+		constexpr static size_t slots {max_fields * 2}; //power of two
+		std::array<field, max_fields> m_fields;
+		std::array<uint8_t, slots> m_index{}; //by case-insensitive name hash, index + 1 into m_fields, 0 if empty
+		std::array<uint8_t, static_cast<size_t>(known::count)> m_known{}; //index + 1 into m_fields, 0 if absent
+		size_t m_size{0};
+	};
+
 	struct request {
 	  public:
 		int epoll_fd;
 		int fd;
-		std::string remote_ip;
+		std::string remote_ip; //x-forwarded-for or the peer address, set by parse()
+		sockaddr_in peer_addr{}; //as returned by accept4(), formatted only when a request is parsed
+		uint32_t generation{0};
+		unsigned int requests_served{0};
 		request_internals internals;
 		bool isMultipart{false};
 		bool save_blob_failed{false};
 		std::string method;
 		std::string queryString;
 		std::string path;
+		router::path_params path_params; //views into path, set when the route is matched
+		std::string cache_key; //response cache key of a miss, the worker stores the response under it; keeps its capacity
 		std::string boundary;
 		std::string token;
 		std::string origin;
 		socket_buffer payload;
-		std::map<std::string, std::string, std::less<>> headers;
-		std::map<std::string, std::string, std::less<>> params;
-		std::vector<input_rule> input_rules;
+		header_table headers;
+		multipart_decoder form;
+		param_store params;
+		const validation_plan* input_rules{nullptr}; //of the API, set before the body is read: its JSON fields are extracted
+		std::vector<param_value> values; //typed values, same order as the rules of the plan
 		jwt::user_info user_info;
 		response_stream response;
 		
-		explicit request(int epollfd, int fdes, const std::string& ip): epoll_fd{epollfd}, fd {fdes}, remote_ip {ip}
+		explicit request(int epollfd, int fdes, const sockaddr_in& addr): epoll_fd{epollfd}, fd {fdes}, peer_addr {addr}
 		{ }
 
 		request() = default;
-		void parse();
+		void reset(bool keep_pipelined = false) noexcept;
+		bool parse();
 		bool eof();
-		std::string get_header(const std::string& name) const;
+		bool expects_continue() const noexcept;
+		//called once the headers were parsed, a body larger than max_bytes (0 means no limit) is rejected with 413
+		//before it is read, otherwise the buffer is presized for it
+		bool limit_body(size_t max_bytes);
+		//fails the request before its body is read, the connection is closed after the response
+		void reject(status s, std::string_view msg);
+		//the view is valid until the request is reset for the next one on the connection
+		std::string_view get_header(std::string_view name) const noexcept;
+		std::string_view get_header(header_table::known k) const noexcept;
 		std::string get_param(const std::string& name) const;
 		void enforce(verb v) const;
-		void enforce(const std::vector<input_rule>& rules);
+		void enforce(const validation_plan& plan);
+		//typed value of a field validated by the API input rules
+		const param_value& get_value(std::string_view name) const noexcept;
 		
 		template<class FN>
 		void enforce(const std::string& id, const std::string& error_description, FN fn) const
@@ -324,22 +655,26 @@ namespace http
 		void send_mail(const std::string& to, std::string& cc, std::string& subject, const std::string& body, std::string& attachment, std::string& attachment_filename);
 		
 		std::string_view get_body() const noexcept;
+		size_t message_size() const noexcept;
 
 		void delete_blobs();
+		//the connection is closed before its upload completed
+		void cancel_upload() noexcept;
 		
 	  private:
-		void test_field(const http::input_rule& r, std::string& value);
-		constexpr std::string decode_param(std::string_view value) const noexcept;
+		void test_field(const http::input_rule& r, std::string_view value, std::string& out, param_value& typed);
 		void parse_param(std::string_view param) noexcept; 
 		void parse_query_string(std::string_view qs) noexcept;	
-		bool parse_headers(line_reader& lr);
+		bool parse_header_line(std::string_view line);
+		void finish_headers();
 		bool parse_read_boundary(std::string_view value);
-		std::pair<std::string, std::string> split_header_line(std::string_view line);
 		bool set_content_length(std::string_view value);
-		bool add_header(const std::string& header, const std::string& value);
-		bool parse_uri(line_reader& lr);
-		void set_parse_error(std::string_view msg);
-		bool validate_header(std::string_view header, std::string_view value);
+		bool add_header(std::string_view header, std::string_view value);
+		bool parse_uri(std::string_view line);
+		void set_parse_error(std::string_view msg, status s = status::bad_request);
+		bool validate_headers();
+		bool decode_chunked();
+		size_t body_end() const noexcept;
 		void parse_form();
 	};
 }
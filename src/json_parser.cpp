@@ -6,6 +6,240 @@
 
 namespace json {
 
+namespace {
+
+// single pass RFC 8259 scanner used by json_parser::extract()
+class scanner {
+public:
+    explicit scanner(std::string_view text) noexcept : text_{text} {}
+
+    void skip_ws() noexcept {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r'))
+            ++pos_;
+    }
+
+    char peek() const {
+        if (pos_ >= text_.size())
+            fail("unexpected end of input");
+        return text_[pos_];
+    }
+
+    void expect(char c) {
+        if (peek() != c)
+            fail(std::format("expected '{}'", c));
+        ++pos_;
+    }
+
+    bool consume(char c) {
+        if (peek() != c)
+            return false;
+        ++pos_;
+        return true;
+    }
+
+    // only whitespace may follow the value
+    void finish() {
+        skip_ws();
+        if (pos_ != text_.size())
+            fail("unexpected data after the JSON value");
+    }
+
+    // a string at the current position, with decode the unescaped text is returned (a view into the input
+    // if it has no escapes, into out otherwise), without it the string is only validated
+    std::string_view string(std::string& out, bool decode) {
+        expect('"');
+        const size_t start {pos_};
+        bool escaped {false};
+        out.clear();
+        while (true) {
+            const char c {peek()};
+            if (c == '"')
+                break;
+            if (static_cast<unsigned char>(c) < 0x20)
+                fail("control character in string");
+            if (c != '\\') {
+                ++pos_;
+                continue;
+            }
+            if (decode && !escaped)
+                out.assign(text_.substr(start, pos_ - start));
+            escaped = true;
+            ++pos_;
+            escape(out, decode);
+            // the unescaped runs are copied one at a time from here on
+            while (decode && peek() != '"' && peek() != '\\') {
+                if (static_cast<unsigned char>(peek()) < 0x20)
+                    fail("control character in string");
+                out.push_back(text_[pos_++]);
+            }
+        }
+        const std::string_view raw {text_.substr(start, pos_ - start)};
+        ++pos_;
+        return escaped ? std::string_view{out} : raw;
+    }
+
+    // a number, true, false or null as written, an empty view for null; strings are unescaped with decode
+    std::string_view scalar(std::string& out, bool decode) {
+        switch (const char c {peek()}) {
+            case '"': return string(out, decode);
+            case 't': return literal("true");
+            case 'f': return literal("false");
+            case 'n': literal("null"); return {};
+            default:
+                if (c == '-' || (c >= '0' && c <= '9'))
+                    return number();
+                fail("unexpected character");
+        }
+    }
+
+    // any value, only validated
+    void skip_value(std::string& scratch, int depth) {
+        if (depth > max_depth)
+            fail("nesting too deep");
+        const char c {peek()};
+        if (c != '{' && c != '[') {
+            scalar(scratch, false);
+            return;
+        }
+        ++pos_;
+        const char close {c == '{' ? '}' : ']'};
+        skip_ws();
+        if (consume(close))
+            return;
+        do {
+            skip_ws();
+            if (close == '}') {
+                string(scratch, false);
+                skip_ws();
+                expect(':');
+                skip_ws();
+            }
+            skip_value(scratch, depth + 1);
+            skip_ws();
+        } while (consume(','));
+        expect(close);
+    }
+
+    [[noreturn]] void fail(std::string_view what) const {
+        throw parsing_error(std::format("JSON parsing error: {} at offset {}", what, pos_));
+    }
+
+private:
+    static constexpr int max_depth {32};
+
+    static int hex_digit(char c) noexcept {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    unsigned code_unit() {
+        unsigned cu {0};
+        for (int i = 0; i < 4; i++) {
+            const int d {hex_digit(peek())};
+            if (d < 0)
+                fail("invalid \\u escape");
+            cu = cu << 4 | static_cast<unsigned>(d);
+            ++pos_;
+        }
+        return cu;
+    }
+
+    // the character after the backslash
+    void escape(std::string& out, bool decode) {
+        char c {peek()};
+        ++pos_;
+        switch (c) {
+            case '"': case '\\': case '/': break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'u': {
+                unsigned cp {code_unit()};
+                // a surrogate pair encodes a code point above the BMP, a lone surrogate becomes U+FFFD
+                if (cp >= 0xD800 && cp <= 0xDBFF && text_.substr(pos_).starts_with("\\u")) {
+                    pos_ += 2;
+                    const unsigned low {code_unit()};
+                    cp = (low >= 0xDC00 && low <= 0xDFFF) ? 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00) : 0xFFFD;
+                } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                if (decode)
+                    append_utf8(out, cp);
+                return;
+            }
+            default:
+                fail("invalid escape");
+        }
+        if (decode)
+            out.push_back(c);
+    }
+
+    static void append_utf8(std::string& out, unsigned cp) {
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | cp >> 6));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | cp >> 12));
+            out.push_back(static_cast<char>(0x80 | (cp >> 6 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | cp >> 18));
+            out.push_back(static_cast<char>(0x80 | (cp >> 12 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp >> 6 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    std::string_view literal(std::string_view word) {
+        if (!text_.substr(pos_).starts_with(word))
+            fail("invalid literal");
+        pos_ += word.size();
+        return word;
+    }
+
+    bool digits() noexcept {
+        const size_t start {pos_};
+        while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9')
+            ++pos_;
+        return pos_ > start;
+    }
+
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    std::string_view number() {
+        const size_t start {pos_};
+        if (text_[pos_] == '-')
+            ++pos_;
+        if (pos_ < text_.size() && text_[pos_] == '0')
+            ++pos_;
+        else if (!digits())
+            fail("invalid number");
+        if (pos_ < text_.size() && text_[pos_] == '.') {
+            ++pos_;
+            if (!digits())
+                fail("invalid number");
+        }
+        if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+            ++pos_;
+            if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-'))
+                ++pos_;
+            if (!digits())
+                fail("invalid number");
+        }
+        return text_.substr(start, pos_ - start);
+    }
+
+    std::string_view text_;
+    size_t pos_ {0};
+};
+
+} // namespace
+
 // parsing_error implementation
 parsing_error::parsing_error(const std::string& msg)
     : std::runtime_error(msg) {}
@@ -167,6 +401,41 @@ std::map<std::string, std::string, std::less<>> json_parser::get_map() const {
     return fields;
 }
 
+void json_parser::extract(std::string_view json_str,
+                          const std::function<bool(std::string_view)>& wanted,
+                          const std::function<void(std::string_view, std::string_view)>& fn) {
+    scanner sc {json_str};
+    std::string key_buf;
+    std::string value_buf;
+    sc.skip_ws();
+    if (sc.peek() != '{') {
+        sc.skip_value(value_buf, 0);
+        sc.finish();
+        return;
+    }
+    sc.expect('{');
+    sc.skip_ws();
+    if (!sc.consume('}')) {
+        do {
+            sc.skip_ws();
+            const std::string_view key {sc.string(key_buf, true)};
+            sc.skip_ws();
+            sc.expect(':');
+            sc.skip_ws();
+            if (const char c {sc.peek()}; c == '{' || c == '[') {
+                sc.skip_value(value_buf, 1);
+            } else if (wanted(key)) {
+                fn(key, sc.scalar(value_buf, true));
+            } else {
+                sc.scalar(value_buf, false);
+            }
+            sc.skip_ws();
+        } while (sc.consume(','));
+        sc.expect('}');
+    }
+    sc.finish();
+}
+
 json_parser::json_parser(struct json_object* obj) noexcept : obj_(obj) {}
 
 } // namespace json
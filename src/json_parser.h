@@ -1,6 +1,7 @@
 #pragma once
 
 #include <json-c/json.h>
+#include <functional>
 #include <map>
 #include <stdexcept>
 #include <string>
@@ -113,6 +114,20 @@ public:
      */
     [[nodiscard]] std::map<std::string, std::string, std::less<>> get_map() const;
 
+    /**
+     * @brief Extracts the top-level scalar fields of a JSON object in a single pass, without building a tree.
+     * @note The whole text is validated, fields whose key is not wanted and nested objects/arrays are skipped
+     * without being decoded. Strings are unescaped, numbers and true/false are passed as written, null as an
+     * empty string. A valid JSON text that is not an object yields no fields.
+     * @param json_str The JSON string to scan.
+     * @param wanted Called with each top-level key, returns true if its value must be extracted.
+     * @param fn Called with the key and the value of each wanted field, the views are only valid during the call.
+     * @throws json::parsing_error if the string is not valid JSON.
+     */
+    static void extract(std::string_view json_str,
+                        const std::function<bool(std::string_view)>& wanted,
+                        const std::function<void(std::string_view, std::string_view)>& fn);
+
 private:
     explicit json_parser(struct json_object* obj) noexcept;
     struct json_object* obj_;
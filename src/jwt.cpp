@@ -1,4 +1,5 @@
 #include "jwt.h"
+#include "clock_cache.h"
 
 namespace 
 {
@@ -234,7 +235,7 @@ namespace jwt
 	std::string get_token(std::string_view sessionid, std::string_view username, std::string_view mail, std::string_view roles) 
 	{
 		static jwt_config config;
-		const time_t now {std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) + config.duration}; 
+		const time_t now {clock_cache::now() + config.duration}; 
 		const std::string json_header {R"({"alg":"HS256","typ":"JWT"})"};
 		const std::string json_payload = std::format(
 			R"({{"sid":"{}","login":"{}","mail":"{}","roles":"{}","exp":{}}})",
@@ -261,7 +262,7 @@ namespace jwt
 			return std::make_pair(false, user_info());
 		}
 		auto user {parse_payload(jt.payload)};
-		const time_t now {std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())};
+		const time_t now {clock_cache::now()};
 		if (now < user.exp)
 			return std::make_pair(true, user);
 		else {
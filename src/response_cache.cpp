@@ -0,0 +1,76 @@
+#include "response_cache.h"
+
+namespace
+{
+	//list node, index node and bucket, roughly
+	constexpr size_t entry_overhead {128};
+}
+
+response_cache::response_cache(size_t max_bytes): m_shard_budget{max_bytes / shard_count}
+{
+}
+
+response_cache::shard& response_cache::shard_of(std::string_view key) noexcept
+{
+	return m_shards[std::hash<std::string_view>{}(key) % shard_count];
+}
+
+void response_cache::erase(shard& s, std::list<entry>::iterator it)
+{
+	s.bytes -= it->cost;
+	s.index.erase(it->key);
+	s.lru.erase(it);
+}
+
+response_cache::value_type response_cache::get(std::string_view key)
+{
+	auto& s {shard_of(key)};
+	std::scoped_lock lock {s.mutex};
+	const auto found {s.index.find(key)};
+	if (found == s.index.end())
+		return nullptr;
+	const auto it {found->second};
+	if (it->expires <= std::chrono::steady_clock::now()) {
+		erase(s, it);
+		return nullptr;
+	}
+	s.lru.splice(s.lru.begin(), s.lru, it);
+	return it->value;
+}
+
+void response_cache::put(std::string key, value_type value, std::chrono::seconds ttl)
+{
+	const size_t cost {2 * key.size() + value->size() + entry_overhead};
+	if (cost > m_shard_budget)
+		return;
+	auto& s {shard_of(key)};
+	const auto expires {std::chrono::steady_clock::now() + ttl};
+	std::scoped_lock lock {s.mutex};
+	if (const auto found {s.index.find(key)}; found != s.index.end())
+		erase(s, found->second);
+	while (!s.lru.empty() && s.bytes + cost > m_shard_budget)
+		erase(s, std::prev(s.lru.end()));
+	s.lru.push_front(entry{std::move(key), std::move(value), expires, cost});
+	s.index.try_emplace(s.lru.front().key, s.lru.begin());
+	s.bytes += cost;
+}
+
+size_t response_cache::bytes() const
+{
+	size_t total {0};
+	for (const auto& s: m_shards) {
+		std::scoped_lock lock {s.mutex};
+		total += s.bytes;
+	}
+	return total;
+}
+
+size_t response_cache::entries() const
+{
+	size_t total {0};
+	for (const auto& s: m_shards) {
+		std::scoped_lock lock {s.mutex};
+		total += s.lru.size();
+	}
+	return total;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file response_cache.h
+ * @brief Sharded LRU cache of complete API responses with a TTL per entry and a memory bound.
+ */
+
+#ifndef RESPONSE_CACHE_H_
+#define RESPONSE_CACHE_H_
+
+#include <array>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "httputils.h"
+
+/**
+ * @brief Sharded LRU cache of complete API responses with a TTL per entry and a memory bound.
+ *
+ * Keys are hashed to one of 16 shards, each one a mutex, a recency list and an index of views into the keys
+ * stored in the list, so a reactor looking up an entry only contends with the threads using the same shard.
+ * The memory bound is split evenly among the shards; inserting past it evicts the least recently used entries
+ * of the shard, expired entries are dropped when they are found. Values are shared, a hit copies a pointer.
+ */
+class response_cache {
+public:
+	using value_type = std::shared_ptr<const http::response_snapshot>;
+	static constexpr size_t shard_count {16};
+
+	explicit response_cache(size_t max_bytes);
+
+	//nullptr if absent or expired
+	value_type get(std::string_view key);
+	//replaces an existing entry, values larger than a shard are not cached
+	void put(std::string key, value_type value, std::chrono::seconds ttl);
+	size_t bytes() const;
+	size_t entries() const;
+
+private:
+	struct entry {
+		std::string key;
+		value_type value;
+		std::chrono::steady_clock::time_point expires;
+		size_t cost {0};
+	};
+
+	struct shard {
+		mutable std::mutex mutex;
+		std::list<entry> lru; //most recently used first
+		std::unordered_map<std::string_view, std::list<entry>::iterator> index; //keys point into lru
+		size_t bytes {0};
+	};
+
+	shard& shard_of(std::string_view key) noexcept;
+	static void erase(shard& s, std::list<entry>::iterator it);
+
+	std::array<shard, shard_count> m_shards;
+	size_t m_shard_budget;
+};
+
+#endif /* RESPONSE_CACHE_H_ */
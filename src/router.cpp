@@ -0,0 +1,140 @@
+#include "router.h"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace
+{
+	bool is_valid_value(std::string_view segment, router::param_type type) noexcept
+	{
+		if (type == router::param_type::str)
+			return true;
+		long long value {0};
+		const auto [ptr, ec] {std::from_chars(segment.data(), segment.data() + segment.size(), value)};
+		return ec == std::errc() && ptr == segment.data() + segment.size();
+	}
+
+	//{name} or {name:type}, the braces excluded
+	std::pair<std::string_view, router::param_type> parse_param(std::string_view spec)
+	{
+		const auto colon {spec.find(':')};
+		const std::string_view name {spec.substr(0, colon)};
+		const std::string_view type {colon == std::string_view::npos ? "str" : spec.substr(colon + 1)};
+		if (name.empty())
+			throw std::invalid_argument("path parameter without a name");
+		if (type == "int")
+			return {name, router::param_type::integer};
+		if (type == "str")
+			return {name, router::param_type::str};
+		throw std::invalid_argument("unknown path parameter type: " + std::string{type});
+	}
+}
+
+namespace router
+{
+	std::string_view path_params::get(std::string_view name) const noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			if (items[i].first == name)
+				return items[i].second;
+		return "";
+	}
+
+	void radix_tree::add(std::string_view path_template, int route)
+	{
+		node* n {&m_root};
+		size_t params {0};
+		size_t pos {0};
+		while (pos < path_template.size()) {
+			if (path_template[pos] != '{') {
+				const auto literal {path_template.substr(pos, path_template.find('{', pos) - pos)};
+				n = &insert_literal(*n, literal);
+				pos += literal.size();
+				continue;
+			}
+			const auto close {path_template.find('}', pos)};
+			if (close == std::string_view::npos || pos == 0 || path_template[pos - 1] != '/'
+				|| (close + 1 < path_template.size() && path_template[close + 1] != '/'))
+				throw std::invalid_argument("a path parameter must be a whole segment: " + std::string{path_template});
+			if (++params > path_params::max_params)
+				throw std::invalid_argument("too many path parameters: " + std::string{path_template});
+			const auto [name, type] {parse_param(path_template.substr(pos + 1, close - pos - 1))};
+			if (!n->param) {
+				n->param = std::make_unique<node>();
+				n->param->param_name = name;
+				n->param->type = type;
+			} else if (n->param->param_name != name || n->param->type != type) {
+				throw std::invalid_argument("path parameter conflicts with another route: " + std::string{path_template});
+			}
+			n = n->param.get();
+			pos = close + 1;
+		}
+		if (n->route != npos)
+			throw std::invalid_argument("duplicated route: " + std::string{path_template});
+		n->route = route;
+		++m_size;
+	}
+
+	//follows or splits the literal edges, returns the node at the end of the literal
+	radix_tree::node& radix_tree::insert_literal(node& n, std::string_view literal)
+	{
+		node* current {&n};
+		while (!literal.empty()) {
+			const auto child {std::ranges::find_if(current->children, [c = literal[0]](const node& x) { return x.prefix[0] == c; })};
+			if (child == current->children.end()) {
+				node& leaf {current->children.emplace_back()};
+				leaf.prefix = literal;
+				return leaf;
+			}
+			const auto common {static_cast<size_t>(std::ranges::mismatch(child->prefix, literal).in1 - child->prefix.begin())};
+			if (common < child->prefix.size()) {
+				node tail;
+				tail.prefix = child->prefix.substr(common);
+				tail.children = std::move(child->children);
+				tail.param = std::move(child->param);
+				tail.route = child->route;
+				child->prefix.resize(common);
+				child->children.clear();
+				child->children.push_back(std::move(tail));
+				child->route = npos;
+			}
+			literal.remove_prefix(common);
+			current = &*child;
+		}
+		return *current;
+	}
+
+	bool radix_tree::match(const node& n, std::string_view rest, path_params& params, int& route) noexcept
+	{
+		if (rest.empty()) {
+			route = n.route;
+			return route != npos;
+		}
+		for (const auto& child: n.children) {
+			if (child.prefix[0] != rest[0])
+				continue;
+			if (rest.starts_with(child.prefix) && match(child, rest.substr(child.prefix.size()), params, route))
+				return true;
+			break;
+		}
+		if (!n.param)
+			return false;
+		const auto segment {rest.substr(0, rest.find('/'))};
+		if (segment.empty() || !is_valid_value(segment, n.param->type))
+			return false;
+		params.items[params.count++] = {n.param->param_name, segment};
+		if (match(*n.param, rest.substr(segment.size()), params, route))
+			return true;
+		--params.count;
+		return false;
+	}
+
+	int radix_tree::find(std::string_view path, path_params& params) const noexcept
+	{
+		params.clear();
+		int route {npos};
+		if (!match(m_root, path, params, route))
+			return npos;
+		return route;
+	}
+}
@@ -0,0 +1,70 @@
+/**
+ * @file router.h
+ * @brief Radix trie that maps request paths to routes, with typed path parameters.
+ */
+
+#ifndef ROUTER_H_
+#define ROUTER_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Radix trie that maps request paths to routes, with typed path parameters.
+ *
+ * Templates are literal paths with optional parameter segments, /api/customers/{id:int}/orders, where the type
+ * is int or str (the default). Literal runs are stored as compressed edges, so a lookup compares each byte of the
+ * path once; a parameter matches a whole non-empty segment of its type and is returned as a view into the path.
+ * Literal edges take precedence over a parameter at the same position. Built once at startup, read-only after that.
+ */
+namespace router
+{
+	enum class param_type : uint8_t {
+		str,
+		integer
+	};
+
+	//parameters of the matched route, names point into the trie and values into the path
+	struct path_params {
+		static constexpr size_t max_params {8};
+		std::array<std::pair<std::string_view, std::string_view>, max_params> items;
+		size_t count {0};
+
+		std::string_view get(std::string_view name) const noexcept;
+		void clear() noexcept { count = 0; }
+	};
+
+	class radix_tree {
+	public:
+		static constexpr int npos {-1};
+
+		//throws std::invalid_argument if the template is malformed or conflicts with one already added
+		void add(std::string_view path_template, int route);
+		//route of the path or npos, params receives the values of its parameters
+		int find(std::string_view path, path_params& params) const noexcept;
+		size_t size() const noexcept { return m_size; }
+
+	private:
+		struct node {
+			std::string prefix; //literal label of the edge leading to this node, empty for a parameter
+			std::vector<node> children; //literal edges, their first bytes are distinct
+			std::unique_ptr<node> param; //a parameter segment follows
+			std::string param_name;
+			param_type type {param_type::str};
+			int route {npos};
+		};
+
+		static node& insert_literal(node& n, std::string_view literal);
+		static bool match(const node& n, std::string_view rest, path_params& params, int& route) noexcept;
+
+		node m_root;
+		size_t m_size {0};
+	};
+}
+
+#endif /* ROUTER_H_ */
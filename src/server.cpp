@@ -9,6 +9,9 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include "clock_cache.h"
+#include <sys/timerfd.h>
 #include <netinet/tcp.h>
 #include <array>
 #include <iostream>
@@ -57,18 +60,9 @@ namespace {
 		return ec.message();
 	}
 	
-	std::string get_peer_ip_ipv4(int sockfd) {
-		sockaddr_in addr{};
-
-		if (socklen_t addr_len = sizeof(addr);
-			getpeername(sockfd, static_cast<sockaddr*>(static_cast<void*>(&addr)), &addr_len) == 0) 
-		{
-			std::array<char, INET_ADDRSTRLEN> buffer{};
-			if (inet_ntop(AF_INET, &addr.sin_addr, buffer.data(), buffer.size())) {
-				return std::string{buffer.data()};
-			}
-		}
-		return "";
+	void set_socket_option(int fd, int level, int option, int value, std::string_view name) {
+		if (setsockopt(fd, level, option, &value, sizeof(value)) == -1)
+			logger::log("epoll", "warn", std::format("setsockopt({}) failed for FD: {} description: {}", name, fd, str_error_cpp(errno)));
 	}
 
 
@@ -113,7 +107,7 @@ namespace {
 	}
 	
 	inline int get_fd(const epoll_event& ev) {
-		return ev.data.fd;
+		return connection_slab::key_fd(ev.data.u64);
 	}
 	
 	constexpr std::string_view get_reason_phrase(http::status s) {
@@ -126,6 +120,8 @@ namespace {
 				case forbidden:           return "Forbidden";
 				case not_found:           return "Not Found";
 				case method_not_allowed:  return "Method Not Allowed";
+				case payload_too_large:   return "Payload Too Large";
+				case request_header_fields_too_large: return "Request Header Fields Too Large";
 				// Add other status codes used in your application here.
 				default:                                return "Internal Server Error";
 			}
@@ -171,9 +167,8 @@ auto consumer(std::stop_token tok, server* srv)  {
         auto params = std::move(srv->m_queue.front());
         srv->m_queue.pop();
         lock.unlock();
-        srv->http_server(params.req, params.api);
-        std::scoped_lock ready_lock{srv->m_ready_mutex};
-        srv->m_ready_queue.push(std::move(params.req));
+        srv->http_server(*params.req, params.api);
+        srv->notify_ready(*params.owner, params.req);
     }
 }
 
@@ -181,17 +176,20 @@ auto consumer(std::stop_token tok, server* srv)  {
 server::webapi::webapi(
     std::string _description, http::verb _verb, 
     std::vector<http::input_rule> _rules, std::vector<std::string> _roles, 
-    std::function<void(http::request&)> _fn, bool _is_secure)
+    std::function<void(http::request&)> _fn, bool _is_secure, size_t _max_body_size, bool _compress,
+    std::string_view _cache_control, std::chrono::seconds _cache_ttl)
 : description{std::move(_description)}, verb{_verb}, rules{std::move(_rules)}, 
-  roles{std::move(_roles)}, fn{std::move(_fn)}, is_secure{_is_secure} {}
+  roles{std::move(_roles)}, fn{std::move(_fn)}, is_secure{_is_secure}, max_body_size{_max_body_size}, compress{_compress},
+  cache_control{_cache_control}, cache_ttl{_cache_ttl} {}
 
-server::server() :	m_signal{get_signalfd()},
+server::server() :	m_cache{static_cast<size_t>(env::cache_mb()) * 1024 * 1024},
+					m_signal{get_signalfd()},
 					pod_name{get_pod_name()},
 					server_start_date{util::current_timestamp()},
 					ALLOWED_ORIGINS{parse_allowed_origins(env::get_str("CPP_ALLOW_ORIGINS"))}
 { }
 
-bool server::is_origin_allowed(const std::string& origin) {
+bool server::is_origin_allowed(std::string_view origin) {
     if (origin.empty()) {
         return true; // No CORS header needed
     }
@@ -201,20 +199,22 @@ bool server::is_origin_allowed(const std::string& origin) {
 void server::send_options(http::request& req) {
     constexpr auto res {
         "HTTP/1.1 204 No Content\r\n"
-        "Date: {:%a, %d %b %Y %H:%M:%S GMT}\r\n"
+        "Date: {}\r\n"
         "Access-Control-Allow-Origin: {}\r\n"
         "Access-Control-Allow-Methods: GET, POST\r\n"
         "Access-Control-Allow-Headers: {}\r\n"
         "Access-Control-Max-Age: 600\r\n"
         "Vary: origin\r\n"
-        "Connection: close\r\n"
+        "Connection: {}\r\n"
         "\r\n"
     };
-    std::string _origin {req.get_header("origin")};
+    const auto _origin {req.get_header(http::header_table::known::origin)};
+    clock_cache::http_date_buffer date;
     req.response << std::format(res, 
-		std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()),
+		clock_cache::http_date(date),
 		_origin,
-		req.get_header("access-control-request-headers")
+		req.get_header("access-control-request-headers"),
+		req.response.connection()
     );
 }
 
@@ -231,11 +231,11 @@ void server::send_options(http::request& req) {
  */
 void server::send_error(http::request& req, const http::status status, std::string_view body) {
     // Log specific errors for internal diagnostics.
-    if (status == http::status::bad_request) {
+    if (req.internals.errcode) {
         logger::log(LOGGER_SRC, "error", 
-            std::format("HTTP status: {} IP: {} {} description: Bad request - {}", 
-                        std::to_underlying(status), req.remote_ip, req.path, req.internals.errmsg), 
-            req.get_header("x-request-id"));
+            std::format("HTTP status: {} IP: {} {} description: {} - {}", 
+                        std::to_underlying(status), req.remote_ip, req.path, get_reason_phrase(status), req.internals.errmsg), 
+            req.get_header(http::header_table::known::x_request_id));
     }
 
     // If no custom body is provided, use the standard reason phrase as the body for convenience.
@@ -245,7 +245,7 @@ void server::send_error(http::request& req, const http::status status, std::stri
 
     // Conditionally generate CORS headers if the origin is allowed.
     std::string cors_headers;
-    if (const std::string origin = req.get_header("origin"); is_origin_allowed(origin)) {
+    if (const auto origin {req.get_header(http::header_table::known::origin)}; is_origin_allowed(origin)) {
         cors_headers = std::format(
             "Access-Control-Allow-Origin: {}\r\n"
             "Vary: Origin\r\n",
@@ -258,26 +258,28 @@ void server::send_error(http::request& req, const http::status status, std::stri
         "HTTP/1.1 {} {}\r\n"
         "Content-Length: {}\r\n"
         "Content-Type: text/plain; charset=utf-8\r\n"
-        "Date: {:%a, %d %b %Y %H:%M:%S GMT}\r\n"
+        "Date: {}\r\n"
         "{}" // Conditional CORS headers
         "Strict-Transport-Security: max-age=31536000; includeSubDomains; preload\r\n"
         "X-Frame-Options: SAMEORIGIN\r\n"
         "X-Content-Type-Options: nosniff\r\n"
         "Referrer-Policy: no-referrer\r\n"
         "Cache-Control: no-store\r\n"
-        "Connection: close\r\n"
+        "Connection: {}\r\n"
         "\r\n"
         "{}"; // Response body
 
     // Build the final response string using std::format.
+    clock_cache::http_date_buffer date;
     const auto response_str = std::format(
         RESPONSE_TEMPLATE,
         std::to_underlying(status),       // {0}: Status code (e.g., 404)
         get_reason_phrase(status),      // {1}: Reason phrase (e.g., "Not Found")
         body.length(),                  // {2}: Length of the response body
-        std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()), // {3}: Current GMT date
+        clock_cache::http_date(date),   // {3}: Current GMT date
         cors_headers,                   // {4}: CORS headers (or empty string)
-        body                            // {5}: The actual response body
+        req.response.connection(),      // {5}: keep-alive or close
+        body                            // {6}: The actual response body
     );
 
     // Append the fully formed response to the request's response buffer.
@@ -300,18 +302,22 @@ void server::execute_service(http::request& req, const std::shared_ptr<const web
     }
     if (api_ptr->is_secure) {
         req.check_security(api_ptr->roles);
-        if (enable_audit) {
-            std::string payload {req.isMultipart ? "multipart-form-data" : req.get_body()};
-            audit_trail at{req.user_info.login, req.remote_ip, req.path, 
-                        payload, req.user_info.sessionid, req.get_header("user-agent"), 
-                        pod_name, req.get_header("x-request-id")};
-            save_audit_trail(at);
-        }
+        if (enable_audit)
+            record_audit(req);
     }
     api_ptr->fn(req);
 }
 
-void server::process_request(http::request& req, const std::shared_ptr<const webapi>& api_ptr)  {
+void server::record_audit(const http::request& req) {
+    std::string payload {req.isMultipart ? "multipart-form-data" : req.get_body()};
+    audit_trail at{req.user_info.login, req.remote_ip, req.path, 
+                payload, req.user_info.sessionid, std::string{req.get_header("user-agent")}, 
+                pod_name, std::string{req.get_header(http::header_table::known::x_request_id)}};
+    save_audit_trail(at);
+}
+
+// returns false if the API failed and the response is an error
+bool server::process_request(http::request& req, const std::shared_ptr<const webapi>& api_ptr)  {
     std::string error_msg;
     try {
         if (req.method == "OPTIONS")
@@ -348,19 +354,46 @@ void server::process_request(http::request& req, const std::shared_ptr<const web
     }
     if (!error_msg.empty()) {
         req.delete_blobs();
-        logger::log("service", "error", std::format("{} {}", req.path, error_msg), req.get_header("x-request-id"));
+        logger::log("service", "error", std::format("{} {}", req.path, error_msg), req.get_header(http::header_table::known::x_request_id));
+        return false;
+    }
+    return true;
+}
+
+// on the worker thread after the API returned, so the reactors never spend CPU on zlib
+void server::compress_response(http::request& req) {
+    static const int level {env::compression_level()};
+    static const size_t min_size {env::compression_min_size()};
+    if (!level || !req.response.compressible(min_size))
+        return;
+    const auto start {std::chrono::high_resolution_clock::now()};
+    const size_t saved {req.response.compress(level)};
+    const std::chrono::duration<double> elapsed {std::chrono::high_resolution_clock::now() - start};
+    m_metrics.compression_time += elapsed.count();
+    if (saved) {
+        ++m_metrics.compressed_responses;
+        m_metrics.compression_saved_bytes += saved;
     }
 }
 
 void server::log_request(const http::request& req, double duration)  {
     constexpr auto msg {"fd={} remote-ip={} {} path={} elapsed-time={:f} user={}"};
-    logger::log("access-log", "info", std::format(msg, req.fd, req.remote_ip, req.method, req.path, duration, req.user_info.login), req.get_header("x-request-id"));
+    logger::log("access-log", "info", std::format(msg, req.fd, req.remote_ip, req.method, req.path, duration, req.user_info.login), req.get_header(http::header_table::known::x_request_id));
 }
 
 void server::http_server(http::request& req, const std::shared_ptr<const webapi>& api_ptr)  {
     ++m_metrics.active_threads;
     auto start = std::chrono::high_resolution_clock::now();
-    process_request(req, api_ptr);
+    const bool ok {process_request(req, api_ptr)};
+    if (ok && api_ptr && !api_ptr->cache_control.empty() && req.method == "GET"
+        && req.response.revalidate(api_ptr->cache_control, req.get_header(http::header_table::known::if_none_match)))
+        ++m_metrics.not_modified;
+    else if (api_ptr && api_ptr->compress)
+        compress_response(req);
+    if (ok && !req.cache_key.empty()) {
+        if (auto snapshot {req.response.snapshot()})
+            m_cache.put(req.cache_key, std::move(snapshot), api_ptr->cache_ttl);
+    }
     auto finish = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = finish - start;
     if (env::http_log_enabled())
@@ -370,17 +403,105 @@ void server::http_server(http::request& req, const std::shared_ptr<const webapi>
     --m_metrics.active_threads;
 }
 
-bool server::read_request(http::request& req, int bytes)  {
-    bool first_packet {req.payload.empty()};
-    req.payload.update_pos(bytes);
-    if (first_packet) {
-        req.parse();
-        if (req.method == "GET" || req.method == "OPTIONS" || req.internals.errcode == -1)
+bool server::read_request(http::request& req, int bytes, std::string_view received)  {
+    // a body without a limit (CPP_MAX_BODY_KB=0) can outgrow the memory, the request fails instead of the server
+    try {
+        req.payload.update_pos(bytes);
+        req.payload.append(received);
+    } catch (const std::bad_alloc&) {
+        req.reject(http::status::payload_too_large, std::format("Payload too large -> out of memory buffering {} bytes", req.payload.buffer_size()));
+        return true;
+    }
+    if (req.internals.bodyStartPos == 0) {
+        // headers may take several reads, the parser resumes where the previous read left it
+        if (!req.parse())
+            return false;
+        // the last request allowed on a persistent connection announces its closing
+        if (!env::keepalive_timeout() || req.requests_served + 1 >= env::keepalive_requests())
+            req.response.set_keep_alive(false);
+        if (req.internals.errcode == -1 || ((req.method == "GET" || req.method == "OPTIONS") && !req.internals.contentLength && !req.internals.chunked))
+            return true;
+        // an oversized body is refused before it is buffered, a JSON one is only scanned for the API's input rules
+        const route* rt {find_route(req)};
+        const webapi* api_ptr {rt ? rt->api.get() : nullptr};
+        if (!req.limit_body(max_body_size(api_ptr)))
+            return true;
+        if (api_ptr)
+            req.input_rules = &api_ptr->rules;
+        // nothing of the body was sent yet, the client waits for our go-ahead
+        if (req.expects_continue() && static_cast<size_t>(req.payload.size()) == req.internals.bodyStartPos && !accept_upload(req))
             return true;
     }
     return req.eof();
 }
 
+// the route of the request path, its path parameters are left in the request
+const server::route* server::find_route(http::request& req) const noexcept {
+    if (const int idx {m_router.find(req.path, req.path_params)}; idx != router::radix_tree::npos)
+        return &m_routes[static_cast<size_t>(idx)];
+    return nullptr;
+}
+
+// every registered API plus the built-ins answered by the reactor, fails on malformed or conflicting templates
+void server::build_router() {
+    m_routes.clear();
+    m_routes.reserve(webapi_catalog.size() + 2);
+    const auto add {[this](std::string_view path, route rt) {
+        try {
+            m_router.add(path, static_cast<int>(m_routes.size()));
+        } catch (const std::invalid_argument& e) {
+            throw server_startup_exception(std::format("cannot register WebAPI {}: {}", path, e.what()));
+        }
+        m_routes.push_back(std::move(rt));
+    }};
+    add("/api/ping", route{nullptr, route::builtin::ping});
+    add("/api/sysinfo", route{nullptr, route::builtin::sysinfo});
+    for (const auto& [path, api]: webapi_catalog)
+        add(path, route{api, route::builtin::none});
+    logger::log("server", "info", std::format("router built with {} routes", m_router.size()));
+}
+
+// the route's own limit if it has one, CPP_MAX_BODY_KB otherwise
+size_t server::max_body_size(const webapi* api) const noexcept {
+    if (api && api->max_body_size)
+        return api->max_body_size;
+    return static_cast<size_t>(env::max_body_kb()) * 1024;
+}
+
+// Expect: 100-continue - the route and the credentials are checked before the client sends the body,
+// a rejected request is answered right away and its connection closed without reading the body
+bool server::accept_upload(http::request& req)  {
+    using enum http::status;
+    if (!is_origin_allowed(req.origin)) {
+        req.reject(forbidden, std::format("CORS origin denied: {}", req.origin));
+        return false;
+    }
+    const route* rt {find_route(req)};
+    if (!rt || !rt->api) {
+        req.reject(not_found, std::format("API not found: {}", req.path));
+        return false;
+    }
+    try {
+        req.enforce(rt->api->verb);
+        if (rt->api->is_secure)
+            req.check_security(rt->api->roles);
+    } catch (const http::method_not_allowed_exception& e) {
+        req.reject(method_not_allowed, e.what());
+        return false;
+    } catch (const http::login_required_exception& e) {
+        req.reject(unauthorized, e.what());
+        return false;
+    } catch (const http::access_denied_exception& e) {
+        req.reject(forbidden, e.what());
+        return false;
+    }
+    // a fresh socket always has room for it, if not the client sends the body after its own timeout anyway
+    constexpr std::string_view continue_100 {"HTTP/1.1 100 Continue\r\n\r\n"};
+    if (send(req.fd, continue_100.data(), continue_100.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(continue_100.size()))
+        logger::log("epoll", "warn", std::format("unable to send 100 Continue to FD: {}", req.fd), req.get_header(http::header_table::known::x_request_id));
+    return true;
+}
+
 int server::get_signalfd() {
     signal(SIGPIPE, SIG_IGN);
     sigset_t sigset;
@@ -395,14 +516,26 @@ int server::get_signalfd() {
 }
 
 int server::get_listenfd(int port) {
-    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
     if (fd == -1) {
         throw server_startup_exception("socket() failed");
     }
 
     int on = 1;
     setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
-    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    // every reactor binds its own listener to the same port, the kernel balances new connections among them
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+        close(fd);
+        throw server_startup_exception(std::format("setsockopt(SO_REUSEPORT) failed description: {}", str_error_cpp(errno)));
+    }
+    // accepted sockets inherit TCP_NODELAY from the listener, no setsockopt() per connection
+    if (env::tcp_nodelay())
+        set_socket_option(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    // the connection is not reported until the client sends data, or the timeout expires
+    if (env::defer_accept())
+        set_socket_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, env::defer_accept(), "TCP_DEFER_ACCEPT");
+    if (env::tcp_fastopen())
+        set_socket_option(fd, IPPROTO_TCP, TCP_FASTOPEN, env::tcp_fastopen(), "TCP_FASTOPEN");
 
     sockaddr_in addr{};
     addr.sin_port = htons(port);
@@ -421,90 +554,175 @@ int server::get_listenfd(int port) {
 
 void server::epoll_add_event(int fd, int epoll_fd, uint32_t event_flags) {
     epoll_event event;
-    event.data.fd = fd;
+    event.data.u64 = connection_slab::make_key(fd, 0);
     event.events = event_flags;
     epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
 }
 
-void server::epoll_handle_error(const epoll_event& ev) {
-    --m_metrics.connections;
-    if (auto it = buffers.find(ev.data.fd); it == buffers.end()) { 
+void server::epoll_handle_error(reactor& r, const epoll_event& ev) {
+    if (const http::request* req = r.connections.get(ev.data.u64); !req) { 
 		logger::log("epoll", "error", std::format("EPOLLERR unable to retrieve request object for fd {}", get_fd(ev)));
     } else {
-        http::request& req = it->second;
-        logger::log("epoll", "error", std::format("error on connection for FD: {} {} - closing it", req.fd, get_socket_error(req.fd)));
-        if (close(req.fd) == -1)
-            logger::log("epoll", "error", std::format("close FAILED for FD: {} description: {}", req.fd, str_error_cpp(errno)));
-        buffers.erase(ev.data.fd);
+        logger::log("epoll", "error", std::format("error on connection for FD: {} {} - closing it", req->fd, get_socket_error(req->fd)));
+        epoll_close_connection(r, req->fd);
     }
 }
 
-void server::epoll_handle_close(const epoll_event& ev) {
-    --m_metrics.connections;
-    if (auto it = buffers.find(ev.data.fd); it == buffers.end()) { 
+void server::epoll_handle_close(reactor& r, const epoll_event& ev) {
+    if (const http::request* req = r.connections.get(ev.data.u64); !req) { 
         logger::log("epoll", "error", std::format("EPOLLRDHUP unable to retrieve request object for fd {}", get_fd(ev)));
     } else {
-        if (http::request& req = it->second; close(req.fd) == -1)
-            logger::log("epoll", "error", std::format("close FAILED for FD: {} description: {}", req.fd, str_error_cpp(errno)));
-        buffers.erase(ev.data.fd);
+        epoll_close_connection(r, req->fd);
     }
 }
 
-void server::epoll_handle_connect(const int& listen_fd, const int& epoll_fd) {
-    while (true) {
-        struct sockaddr addr;
+void server::epoll_handle_connect(reactor& r) {
+    // the listen socket is level-triggered, whatever is left after the batch is accepted on the next
+    // epoll_wait() so an accept storm can't starve reads on established connections
+    static const int accept_batch {std::max(1, static_cast<int>(env::accept_batch()))};
+    for (int i = 0; i < accept_batch; i++) {
+        sockaddr_in addr{};
         socklen_t len = sizeof(addr);
-        int fd { accept4(listen_fd, &addr, &len, SOCK_NONBLOCK) };
+        int fd { accept4(r.listen_fd, static_cast<sockaddr*>(static_cast<void*>(&addr)), &len, SOCK_NONBLOCK | SOCK_CLOEXEC) };
         if (fd == -1) {
             if (errno != EAGAIN && errno != EWOULDBLOCK) 
-                logger::log("epoll", "error", std::format("connection accept FAILED for epoll FD: {} description: {}", epoll_fd, str_error_cpp(errno)));
+                logger::log("epoll", "error", std::format("connection accept FAILED for epoll FD: {} description: {}", r.epoll_fd, str_error_cpp(errno)));
             return;
         }
         ++m_metrics.connections;
-		auto remote_ip{get_peer_ip_ipv4(fd)};
-        if (auto [iter, success] {buffers.try_emplace(fd, epoll_fd, fd, remote_ip)}; success) {
+        if (http::request* req {r.connections.acquire(r.epoll_fd, fd, addr)}; req) {
             epoll_event ev; 
-            ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
-            ev.data.fd = fd;
-            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+            ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+            ev.data.u64 = connection_slab::make_key(fd, req->generation);
+            epoll_ctl(r.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+            arm_timer(r, *req, EPOLLIN);
         } else {
-            logger::log("epoll", "error", std::format("error creating a new request object into the hashmap with fd: {}", fd));
+            logger::log("epoll", "error", std::format("connection slot for fd: {} is still in use - closing it", fd));
+            --m_metrics.connections;
+            close(fd);
             break;
         }
     }
 }
 
-void server::epoll_abort_request(http::request& req, const http::status status_code, std::string_view msg_) {
+void server::epoll_abort_request(reactor& r, http::request& req, const http::status status_code, std::string_view msg_) {
     std::string msg {"Bad request"};
     if (status_code == http::status::not_found) {
-        logger::log("epoll", "error", std::format("API not found: {} from IP {}", req.path, req.remote_ip), req.get_header("x-request-id"));
+        logger::log("epoll", "error", std::format("API not found: {} from IP {}", req.path, req.remote_ip), req.get_header(http::header_table::known::x_request_id));
         msg = "Resource not found";
     }
 	if (!msg_.empty())
 		msg = msg_;
 	if (status_code == http::status::forbidden) 
-        logger::log("security", "warn", std::format("{}: {} from IP {}", msg, req.path, req.remote_ip), req.get_header("x-request-id"));
+        logger::log("security", "warn", std::format("{}: {} from IP {}", msg, req.path, req.remote_ip), req.get_header(http::header_table::known::x_request_id));
     send_error(req, status_code, msg);
+    rearm(r, req, EPOLLOUT);
+}
+
+// connections are registered with EPOLLONESHOT, every handled event must re-arm the fd,
+// event_flags follow epoll semantics for both backends: EPOLLIN read, EPOLLOUT write, 0 wait for the peer to close
+void server::rearm([[maybe_unused]] reactor& r, http::request& req, uint32_t event_flags) {
+    arm_timer(r, req, event_flags);
+#ifdef CPP_IO_URING
+    if (r.ring) {
+        if (event_flags & EPOLLOUT) {
+            // header and body go out as one linked chain, skipping whatever part was already sent
+            const auto chunks {req.response.unsent()};
+            const std::span<const std::string_view> pending {chunks};
+            r.ring->send(req.fd, req.generation, chunks[0].empty() ? pending.subspan(1) : chunks[1].empty() ? pending.first(1) : pending);
+        } else {
+            r.ring->recv(req.fd, req.generation);
+        }
+        return;
+    }
+#endif
     epoll_event event;
-    event.events = EPOLLOUT | EPOLLET | EPOLLRDHUP;
-    event.data.fd = req.fd;
-    epoll_ctl(req.epoll_fd, EPOLL_CTL_MOD, req.fd, &event);
-}
-
-void server::check_ready_queue()  {
-    std::lock_guard lock(m_ready_mutex);
-    while (!m_ready_queue.empty()) {
-        http::request req = std::move(m_ready_queue.front());
-        m_ready_queue.pop();
-        const auto fd {req.fd};
-        const auto epoll_fd {req.epoll_fd};
-        if (auto [iter, success] = buffers.insert_or_assign(fd, std::move(req)); success) {
-			epoll_event event;
-			event.events = EPOLLOUT | EPOLLET | EPOLLRDHUP; 
-			event.data.fd = fd; 
-			if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) 
-				logger::log("epoll", "error", std::format("epoll_ctl ADD failed for FD: {} description: {}", fd, str_error_cpp(errno)));
-		}
+    event.events = event_flags | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.u64 = connection_slab::make_key(req.fd, req.generation);
+    if (epoll_ctl(req.epoll_fd, EPOLL_CTL_MOD, req.fd, &event) == -1)
+        logger::log("epoll", "error", std::format("epoll_ctl MOD failed for FD: {} description: {}", req.fd, str_error_cpp(errno)));
+}
+
+// every armed connection has exactly one deadline, chosen by what it is waiting for
+void server::arm_timer(reactor& r, http::request& req, uint32_t event_flags) {
+    using enum timer_wheel::kind;
+    timer_wheel::node& timer {r.connections.timer(req.fd)};
+    timer_wheel::kind type {idle};
+    unsigned short seconds {env::keepalive_timeout()};
+    if (event_flags & EPOLLOUT || !event_flags) {
+        // refreshed on every write event, also bounds the wait for the peer to close after "Connection: close"
+        type = write_stall;
+        seconds = env::write_timeout();
+    } else if (req.internals.bodyStartPos > 0) {
+        // headers parsed, refreshed on every read of the body
+        type = body_read;
+        seconds = env::body_timeout();
+    } else if (!req.payload.empty() || req.requests_served == 0) {
+        // absolute deadline since accept, a client trickling its headers doesn't get it extended
+        if (timer.type == header_read)
+            return;
+        type = header_read;
+        seconds = env::header_timeout();
+    }
+    if (seconds == 0) {
+        r.timers.cancel(timer);
+        return;
+    }
+    r.timers.schedule(timer, type, std::chrono::seconds{seconds}, std::chrono::steady_clock::now());
+    // the timerfd only moves earlier here, a later deadline is picked up when it fires
+    if (!r.timer_tick || timer.expires < r.timer_tick)
+        arm_timerfd(r, timer.expires);
+}
+
+// one-shot at the start of the tick, tick 0 disarms it; the wheel uses steady_clock, which is CLOCK_MONOTONIC
+void server::arm_timerfd(reactor& r, uint64_t tick) {
+    r.timer_tick = tick;
+    itimerspec spec {};
+    if (tick) {
+        const auto ns {std::chrono::duration_cast<std::chrono::nanoseconds>(r.timers.time_of(tick).time_since_epoch()).count()};
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000;
+    }
+    if (timerfd_settime(r.timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1)
+        logger::log("epoll", "error", std::format("timerfd_settime failed for FD: {} description: {}", r.timer_fd, str_error_cpp(errno)));
+}
+
+void server::epoll_close_connection(reactor& r, int fd) {
+    --m_metrics.connections;
+    r.timers.cancel(r.connections.timer(fd));
+    // the blobs of an upload cut short are not left behind in /var/blobs
+    if (auto* req {r.connections.find(fd)})
+        req->cancel_upload();
+#ifdef CPP_IO_URING
+    // an in-flight recv holds a reference to the socket, shutdown completes it so close() releases the connection
+    if (r.ring)
+        ::shutdown(fd, SHUT_RDWR);
+#endif
+    if (close(fd) == -1)
+        logger::log("epoll", "error", std::format("close FAILED for FD: {} description: {}", fd, str_error_cpp(errno)));
+    r.connections.release(fd);
+}
+
+void server::notify_ready(reactor& r, http::request* req)  {
+    bool was_empty {false};
+    {
+        std::scoped_lock lock{r.ready_mutex};
+        was_empty = r.ready_queue.empty();
+        r.ready_queue.push(req);
+    }
+    // the reactor drains the whole queue on each wakeup, only the first completion needs to signal it
+    if (was_empty && eventfd_write(r.wake_fd, 1) == -1)
+        logger::log("epoll", "error", std::format("eventfd_write failed for FD: {} description: {}", r.wake_fd, str_error_cpp(errno)));
+}
+
+void server::check_ready_queue(reactor& r)  {
+    // reset the eventfd counter before draining so a completion racing with this drain wakes us again
+    eventfd_t value {0};
+    eventfd_read(r.wake_fd, &value);
+    std::lock_guard lock(r.ready_mutex);
+    while (!r.ready_queue.empty()) {
+        rearm(r, *r.ready_queue.front(), EPOLLOUT);
+        r.ready_queue.pop();
     }
 }
 
@@ -514,43 +732,120 @@ void server::producer(worker_params& wp) {
     m_cond.notify_one();
 }
 
-void server::run_async_task(http::request& req) {
+void server::run_async_task(reactor& r, http::request& req) {
     if (req.internals.errcode) {
+        // the stream can't be trusted after a parse error, close the connection after the response
+        req.response.set_keep_alive(false);
         req.delete_blobs();
-        epoll_abort_request(req, http::status::bad_request);
+        epoll_abort_request(r, req, req.internals.errstatus, req.internals.errstatus == http::status::bad_request ? "" : get_reason_phrase(req.internals.errstatus));
         return;
     }
 	if (!is_origin_allowed(req.origin)) {
-		epoll_abort_request(req, http::status::forbidden, std::format("CORS origin denied: {}", req.origin));
+		epoll_abort_request(r, req, http::status::forbidden, std::format("CORS origin denied: {}", req.origin));
 		return;
 	}
-    if (req.path.ends_with("/api/ping")) {
-        epoll_send_ping(req);
+    const route* rt {find_route(req)};
+    if (!rt) {
+        epoll_abort_request(r, req, http::status::not_found);
         return;
     }
-    if (req.path.ends_with("/api/sysinfo")) {
-        epoll_send_sysinfo(req);
+    switch (rt->kind) {
+        case route::builtin::ping:
+            epoll_send_ping(r, req);
+            return;
+        case route::builtin::sysinfo:
+            epoll_send_sysinfo(r, req);
+            return;
+        case route::builtin::none:
+            break;
+    }
+    // path parameters are request parameters too, so input rules and get_param() apply to them
+    for (size_t i = 0; i < req.path_params.count; i++)
+        req.params.set(req.path_params.items[i].first, req.path_params.items[i].second);
+    if (rt->api->cache_ttl.count() > 0 && send_cached(r, req, *rt->api))
         return;
+    // not re-armed: no events are reported for this fd until check_ready_queue() does it,
+    // nor timed out, the worker owns the request until then
+    r.timers.cancel(r.connections.timer(req.fd));
+    worker_params wp {&req, rt->api, &r};
+    producer(wp);
+}
+
+// path, parameters sorted by name, the caller's roles sorted and the negotiated coding, length-prefixed;
+// written into req.cache_key, which keeps its capacity, returns false if the caller has too many roles to cache
+bool server::make_cache_key(http::request& req, const webapi& api) {
+    std::string& key {req.cache_key};
+    key.clear();
+    const auto append {[&key](std::string_view field) {
+        std::format_to(std::back_inserter(key), "{}:{}", field.size(), field);
+    }};
+    append(req.path);
+    for (const auto& [name, value]: req.params.items()) {
+        append(name);
+        append(value);
     }
-    if (auto obj = webapi_catalog.find(req.path); obj != webapi_catalog.end()) {
-        epoll_ctl(req.epoll_fd, EPOLL_CTL_DEL, req.fd, nullptr);
-        auto request_node = buffers.extract(req.fd);
-        worker_params wp {std::move(request_node.mapped()), obj->second};
-        producer(wp);
-    } else {
-        epoll_abort_request(req, http::status::not_found);
+    key.push_back('|');
+    if (api.is_secure) {
+        constexpr size_t max_roles {32};
+        std::array<std::string_view, max_roles> roles;
+        size_t count {0};
+        for (const auto& r: std::views::split(std::string_view{req.user_info.roles}, ',')) {
+            const auto role {trim_whitespace(std::string_view{r.begin(), r.end()})};
+            if (role.empty())
+                continue;
+            if (count == max_roles) {
+                key.clear();
+                return false;
+            }
+            roles[count++] = role;
+        }
+        std::ranges::sort(roles.begin(), roles.begin() + count);
+        for (size_t i = 0; i < count; i++)
+            append(roles[i]);
     }
+    key.push_back(static_cast<char>('0' + std::to_underlying(http::negotiate_encoding(req.get_header(http::header_table::known::accept_encoding)))));
+    return true;
+}
+
+// a GET API with a cache TTL is answered by the reactor on a hit, on a miss req.cache_key is left for the worker;
+// the credentials are checked here, a failure is left to the worker too, it sends the proper error
+bool server::send_cached(reactor& r, http::request& req, const webapi& api) {
+    static const bool enabled {env::cache_mb() > 0};
+    if (!enabled || req.method != "GET" || api.verb != http::verb::GET)
+        return false;
+    if (api.is_secure) {
+        try {
+            req.check_security(api.roles);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    if (!make_cache_key(req, api))
+        return false;
+    const auto cached {m_cache.get(req.cache_key)};
+    if (!cached) {
+        ++m_metrics.cache_misses;
+        return false;
+    }
+    // counted like the requests served by a worker, the processing time of a hit is negligible
+    ++m_metrics.requests_total;
+    ++m_metrics.cache_hits;
+    req.cache_key.clear();
+    if (api.is_secure && enable_audit)
+        record_audit(req);
+    req.response.replay(cached, req.get_header(http::header_table::known::if_none_match));
+    if (env::http_log_enabled())
+        log_request(req, 0);
+    rearm(r, req, EPOLLOUT);
+    return true;
 }
 
-void server::epoll_send_ping(http::request& req) {
+void server::epoll_send_ping(reactor& r, http::request& req) {
     req.response.set_body(R"({"status": "OK"})");
-    epoll_event event;
-    event.events = EPOLLOUT | EPOLLET | EPOLLRDHUP;
-    event.data.fd = req.fd;
-    epoll_ctl(req.epoll_fd, EPOLL_CTL_MOD, req.fd, &event);
+    rearm(r, req, EPOLLOUT);
 }
 
-void server::epoll_send_sysinfo(http::request& req)  {
+void server::epoll_send_sysinfo(reactor& r, http::request& req)  {
     static const auto pool_size {env::pool_size()};
     static const size_t total_ram {util::get_total_memory()};
     const size_t requests_total = m_metrics.requests_total.load(std::memory_order_relaxed);
@@ -565,92 +860,333 @@ void server::epoll_send_sysinfo(http::request& req)  {
     req.response.set_body(std::format(json_template, pod_name, server_start_date, 
         requests_total, avg_time_per_request, connections_count, 
         active_threads_count, pool_size, total_ram, mem_usage));
-    epoll_event event;
-    event.events = EPOLLOUT | EPOLLET | EPOLLRDHUP;
-    event.data.fd = req.fd;
-    epoll_ctl(req.epoll_fd, EPOLL_CTL_MOD, req.fd, &event);
+    rearm(r, req, EPOLLOUT);
 }
 
-void server::epoll_handle_read(http::request& req)  {
+void server::epoll_handle_read(reactor& r, http::request& req)  {
     while (true) {
         int count = read(req.fd, req.payload.data(), req.payload.available_size());
-        if (count == 0) break;
+        if (count == 0) {
+            // peer closed its side, the fd is disarmed so nobody else would release it
+            epoll_close_connection(r, req.fd);
+            return;
+        }
         if (count == -1) {
             if (errno != EAGAIN && errno != EWOULDBLOCK) {
                 logger::log("epoll", "error", std::format("read failed for FD: {} description: {}", req.fd, str_error_cpp(errno)));
-                close(req.fd);
+                epoll_close_connection(r, req.fd);
+            } else {
+                rearm(r, req, EPOLLIN);
             }
             return;
         }
         if (count > 0 && read_request(req, count)) {
-            run_async_task(req);
+            run_async_task(r, req);
             return;
         }
     }
 }
 
-void server::epoll_handle_write(http::request& req)  {
-	if (req.response.write(req.fd)) {
-        epoll_event event;
-        event.events = EPOLLET | EPOLLRDHUP;
-		event.data.fd = req.fd;
-        epoll_ctl(req.epoll_fd, EPOLL_CTL_MOD, req.fd, &event);
+void server::epoll_handle_write(reactor& r, http::request& req)  {
+	if (!req.response.write(req.fd))
+        rearm(r, req, EPOLLOUT);
+    else
+        complete_write(r, req);
+}
+
+void server::complete_write(reactor& r, http::request& req)  {
+	if (req.response.keep_alive()) {
+        // persistent connection: recycle the request object, a pipelined request may be already buffered,
+        // it is served before reading again so responses go out in order and the client is throttled by TCP
+        ++req.requests_served;
+        req.reset(true);
+        if (!req.payload.empty() && read_request(req, 0))
+            run_async_task(r, req);
+        else
+            rearm(r, req, EPOLLIN);
+	} else {
+        // the client closes after reading "Connection: close", EPOLLRDHUP releases the fd
+        rearm(r, req, 0);
 	}
 }
 
-void server::epoll_handle_IO(const epoll_event& ev) {
-    if (auto it = buffers.find(ev.data.fd); it == buffers.end()) {
+void server::expire_timers(reactor& r)  {
+    // the wheel catches up by clock, the expiration count is not needed
+    uint64_t expirations {0};
+    if (read(r.timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN)
+        logger::log("epoll", "error", std::format("timerfd read failed for FD: {} description: {}", r.timer_fd, str_error_cpp(errno)));
+    r.timers.advance(std::chrono::steady_clock::now(), [this, &r](const timer_wheel::node& timer, timer_wheel::kind type) {
+        using enum timer_wheel::kind;
+        switch (type) {
+            case header_read: ++m_metrics.timeouts_header; break;
+            case body_read:   ++m_metrics.timeouts_body; break;
+            case idle:        ++m_metrics.timeouts_idle; break;
+            case write_stall: ++m_metrics.timeouts_write; break;
+            case none: break;
+        }
+        epoll_close_connection(r, timer.fd);
+    });
+    // an idle reactor with no deadlines left doesn't wake up at all
+    arm_timerfd(r, r.timers.next_tick());
+}
+
+void server::epoll_handle_IO(reactor& r, const epoll_event& ev) {
+    if (http::request* req = r.connections.get(ev.data.u64); !req) {
         logger::log("epoll", "error", std::format("epoll_handle_IO() - unable to retrieve request object for fd {}", get_fd(ev)));
         return;
     } else {
-		http::request& req = it->second;
 		if (ev.events & EPOLLIN) {
-			epoll_handle_read(req);
+			epoll_handle_read(r, *req);
 		} else {
-			epoll_handle_write(req);
+			epoll_handle_write(r, *req);
 		}
 	}
 }
 
 
-void server::epoll_loop(int listen_fd, int epoll_fd)  {
+void server::epoll_loop(reactor& r)  {
     constexpr int MAXEVENTS = 1024;
-    constexpr int EPOLL_TIMEOUT_MS = 5;
+    // completed requests arrive via eventfd and connection deadlines via timerfd, no timeout needed
     std::array<epoll_event, MAXEVENTS> events;
     while (true) {
-        int n_events = epoll_wait(epoll_fd, events.data(), MAXEVENTS, EPOLL_TIMEOUT_MS);
-        check_ready_queue();
+        int n_events = epoll_wait(r.epoll_fd, events.data(), MAXEVENTS, -1);
         if (n_events < 0) continue;
         for (int i = 0; i < n_events; i++) {
-            if (events[i].events & EPOLLRDHUP || events[i].events & EPOLLHUP) {
-                epoll_handle_close(events[i]);
+            if (r.wake_fd == get_fd(events[i])) {
+                check_ready_queue(r);
+            } else if (r.timer_fd == get_fd(events[i])) {
+                expire_timers(r);
+            } else if (events[i].events & EPOLLRDHUP || events[i].events & EPOLLHUP) {
+                epoll_handle_close(r, events[i]);
             } else if (events[i].events & EPOLLERR) {
-                epoll_handle_error(events[i]);
-            } else if (m_signal == events[i].data.fd) {
-                logger::log("signal", "info", std::format("stop signal received via epoll: {}", get_signal_name(m_signal)));
+                epoll_handle_error(r, events[i]);
+            } else if (m_signal == get_fd(events[i])) {
+                // the signalfd is level-triggered and shared by all reactors, it is read once by start_epoll()
                 return;
-            } else if (listen_fd == events[i].data.fd) {
-                epoll_handle_connect(listen_fd, epoll_fd);
+            } else if (r.listen_fd == get_fd(events[i])) {
+                epoll_handle_connect(r);
             } else {
-                epoll_handle_IO(events[i]);
+                epoll_handle_IO(r, events[i]);
             }
         }
     }
 }
 
+#ifdef CPP_IO_URING
+void server::uring_loop(reactor& r)  {
+    bool running {true};
+    while (running) {
+        // -EBUSY and -EAGAIN clear up as the completion queue is drained, anything else won't,
+        // retrying would spin and leave this reactor's share of the listen socket unserved
+        if (const int rc {r.ring->wait()}; rc < 0 && rc != -EINTR && rc != -EBUSY && rc != -EAGAIN) {
+            logger::log("uring", "error", std::format("io_uring_submit_and_wait() failed for reactor: {} description: {} - stopping the server", r.id, str_error_cpp(-rc)));
+            kill(getpid(), SIGTERM);
+            return;
+        }
+        r.ring->for_each_completion([this, &r, &running](const io_uring_cqe* cqe) {
+            running = uring_handle_completion(r, cqe) && running;
+        });
+    }
+}
+
+bool server::uring_handle_completion(reactor& r, const io_uring_cqe* cqe)  {
+    using enum uring::op;
+    const auto tag {io_uring_cqe_get_data64(cqe)};
+    switch (uring::tag_op(tag)) {
+        case accept:
+            uring_handle_accept(r, cqe);
+            break;
+        case wake:
+            check_ready_queue(r);
+            if (!(cqe->flags & IORING_CQE_F_MORE))
+                r.ring->poll(r.wake_fd, wake, true);
+            break;
+        case timer:
+            expire_timers(r);
+            if (!(cqe->flags & IORING_CQE_F_MORE))
+                r.ring->poll(r.timer_fd, timer, true);
+            break;
+        case signal:
+            // the signalfd is shared by all reactors, it is read once by start_epoll()
+            return false;
+        case recv:
+        case send:
+        case send_link: {
+            // completions for a connection closed in the meantime carry a stale generation
+            http::request* req {r.connections.find(uring::tag_fd(tag))};
+            if (!req || (req->generation & uring::generation_mask) != uring::tag_generation(tag))
+                break;
+            if (uring::tag_op(tag) == recv)
+                uring_handle_recv(r, *req, cqe);
+            else
+                uring_handle_send(r, *req, cqe);
+            break;
+        }
+    }
+    return true;
+}
+
+// each accept slot is re-armed as soon as it completes, the peer address is copied out of it first
+void server::uring_handle_accept(reactor& r, const io_uring_cqe* cqe)  {
+    const auto slot {uring::tag_generation(io_uring_cqe_get_data64(cqe))};
+    const sockaddr_in addr {r.ring->peer_addr(slot)};
+    r.ring->accept(r.listen_fd, slot);
+    if (cqe->res < 0) {
+        if (cqe->res != -EAGAIN)
+            logger::log("uring", "error", std::format("connection accept FAILED for reactor: {} description: {}", r.id, str_error_cpp(-cqe->res)));
+        return;
+    }
+    const int fd {cqe->res};
+    ++m_metrics.connections;
+    if (http::request* req {r.connections.acquire(r.epoll_fd, fd, addr)}; req) {
+        rearm(r, *req, EPOLLIN);
+    } else {
+        logger::log("uring", "error", std::format("connection slot for fd: {} is still in use - closing it", fd));
+        --m_metrics.connections;
+        close(fd);
+    }
+}
+
+void server::uring_handle_recv(reactor& r, http::request& req, const io_uring_cqe* cqe)  {
+    if (cqe->res == -ENOBUFS) {
+        // all provided buffers were taken by this batch, they are recycled as completions are consumed
+        rearm(r, req, EPOLLIN);
+        return;
+    }
+    // a response that was fully sent with "Connection: close" only waits for the peer to go away
+    const bool closing {req.response.size() > 0 && req.response.pending() == 0};
+    if (cqe->res <= 0 || closing) {
+        if (cqe->res < 0)
+            logger::log("uring", "error", std::format("recv failed for FD: {} description: {}", req.fd, str_error_cpp(-cqe->res)));
+        epoll_close_connection(r, req.fd);
+        return;
+    }
+    // the whole buffer is appended, bytes past the current message belong to a pipelined request
+    if (read_request(req, 0, r.ring->buffer(cqe)))
+        run_async_task(r, req);
+    else
+        rearm(r, req, EPOLLIN);
+}
+
+// sends use MSG_WAITALL, so a failed link is an error and the send after it completes with -ECANCELED,
+// the connection is closed on the first one and the stale generation discards the other
+void server::uring_handle_send(reactor& r, http::request& req, const io_uring_cqe* cqe)  {
+    if (cqe->res < 0) {
+        logger::log("uring", "error", std::format("send failed for FD: {} description: {}", req.fd, str_error_cpp(-cqe->res)));
+        epoll_close_connection(r, req.fd);
+        return;
+    }
+    req.response.consume(cqe->res);
+    if (uring::tag_op(io_uring_cqe_get_data64(cqe)) == uring::op::send_link)
+        return;
+    // whatever is left goes in a new chain
+    if (req.response.pending() > 0)
+        rearm(r, req, EPOLLOUT);
+    else
+        complete_write(r, req);
+}
+#endif
+
+void server::run_reactor(reactor& r)  {
+#ifdef CPP_IO_URING
+    if (r.ring) {
+        // the ring was built by the main thread, it is bound here to the thread that submits to it
+        try {
+            r.ring->enable();
+            uring_loop(r);
+            return;
+        } catch (const uring::setup_error& e) {
+            logger::log("uring", "warn", std::format("reactor: {} {} - falling back to epoll", r.id, e.what()));
+            r.ring.reset();
+            epoll_register(r);
+        }
+    }
+#endif
+    epoll_loop(r);
+}
+
+void server::epoll_register(reactor& r)  {
+    logger::log("epoll", "info", std::format("starting reactor: {} epoll FD: {} listen FD: {} eventfd: {}", r.id, r.epoll_fd, r.listen_fd, r.wake_fd));
+    epoll_add_event(r.listen_fd, r.epoll_fd, EPOLLIN);
+    epoll_add_event(r.wake_fd, r.epoll_fd, EPOLLIN);
+    epoll_add_event(r.timer_fd, r.epoll_fd, EPOLLIN);
+    epoll_add_event(m_signal, r.epoll_fd, EPOLLIN);
+}
+
+std::unique_ptr<server::reactor> server::create_reactor(int id, int port, [[maybe_unused]] bool use_uring) {
+    auto r {std::make_unique<reactor>()};
+    r->id = id;
+    r->epoll_fd.set(epoll_create1(0));
+    if (r->epoll_fd == -1)
+        throw server_startup_exception(std::format("epoll_create1() failed description: {}", str_error_cpp(errno)));
+    r->listen_fd.set(get_listenfd(port));
+    r->wake_fd.set(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    if (r->wake_fd == -1)
+        throw server_startup_exception(std::format("eventfd() failed description: {}", str_error_cpp(errno)));
+    // turns the connection deadlines wheel, created disarmed: it is armed for the earliest deadline only
+    r->timer_fd.set(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+    if (r->timer_fd == -1)
+        throw server_startup_exception(std::format("timerfd_create() failed description: {}", str_error_cpp(errno)));
+#ifdef CPP_IO_URING
+    if (use_uring) {
+        constexpr unsigned RING_ENTRIES {4096};
+        constexpr unsigned short RECV_BUFFERS {256}; // must be a power of 2
+        constexpr unsigned RECV_BUFFER_SIZE {4096};
+        // as many accepts in flight as the epoll backend accepts per wakeup
+        const auto accepts {std::max<unsigned short>(1, env::accept_batch())};
+        try {
+            r->ring = std::make_unique<uring::ring>(RING_ENTRIES, RECV_BUFFERS, RECV_BUFFER_SIZE, accepts);
+            for (unsigned short i = 0; i < accepts; i++)
+                r->ring->accept(r->listen_fd, i);
+            r->ring->poll(r->wake_fd, uring::op::wake, true);
+            r->ring->poll(r->timer_fd, uring::op::timer, true);
+            r->ring->poll(m_signal, uring::op::signal, false);
+            logger::log("uring", "info", std::format("starting reactor: {} io_uring backend listen FD: {} eventfd: {}", id, r->listen_fd, r->wake_fd));
+            return r;
+        } catch (const uring::setup_error& e) {
+            logger::log("uring", "warn", std::format("reactor: {} {} - falling back to epoll", id, e.what()));
+            r->ring.reset();
+        }
+    }
+#endif
+    epoll_register(*r);
+    return r;
+}
+
 void server::start_epoll(int port)  {
-    file_descriptor epoll_fd {epoll_create1(0)};
-    logger::log("epoll", "info", std::format("starting epoll FD: {}", epoll_fd));
-    file_descriptor listen_fd {get_listenfd(port)};
-    epoll_add_event(listen_fd, epoll_fd, EPOLLIN);
-    epoll_add_event(m_signal, epoll_fd, EPOLLIN);
-    epoll_loop(listen_fd, epoll_fd);
+    const int reactors {std::max(1, static_cast<int>(env::reactors()))};
+    const bool use_uring {env::get_str("CPP_IO_BACKEND") == "uring"};
+#ifndef CPP_IO_URING
+    if (use_uring)
+        logger::log("uring", "warn", "CPP_IO_BACKEND=uring but io_uring support was not compiled in (make IO_URING=1) - using epoll");
+#endif
+    m_reactors.reserve(reactors);
+    for (int i = 0; i < reactors; i++)
+        m_reactors.push_back(create_reactor(i, port, use_uring));
+    
+    // reactor 0 runs on the calling thread, the rest get their own thread
+    std::vector<std::jthread> threads;
+    threads.reserve(reactors - 1);
+    for (int i = 1; i < reactors; i++)
+        threads.emplace_back([this, i]() { run_reactor(*m_reactors[i]); });
+    run_reactor(*m_reactors[0]);
+    for (auto& t: threads)
+        t.join();
+    logger::log("signal", "info", std::format("stop signal received via epoll: {}", get_signal_name(m_signal)));
 	logger::log("epoll", "info", "closing file descriptors");
 }
 
 void server::print_server_info()  {
     logger::log("env", "info", std::format("port: {}", env::port()));
     logger::log("env", "info", std::format("pool size: {}", env::pool_size()));
+    logger::log("env", "info", std::format("reactors: {}", env::reactors()));
+    logger::log("env", "info", std::format("keep-alive timeout: {} max requests: {}", env::keepalive_timeout(), env::keepalive_requests()));
+    logger::log("env", "info", std::format("header timeout: {} body timeout: {} write timeout: {}", env::header_timeout(), env::body_timeout(), env::write_timeout()));
+    logger::log("env", "info", std::format("max header size: {} max body KB: {}", env::max_header_size(), env::max_body_kb()));
+    logger::log("env", "info", std::format("compression level: {} min size: {}", env::compression_level(), env::compression_min_size()));
+    logger::log("env", "info", std::format("response cache MB: {}", env::cache_mb()));
+    logger::log("env", "info", std::format("parser scan kernel: {}", scan::kernel()));
+    logger::log("env", "info", std::format("accept batch: {} tcp nodelay: {} defer accept: {} tcp fastopen: {}", env::accept_batch(), env::tcp_nodelay(), env::defer_accept(), env::tcp_fastopen()));
     logger::log("env", "info", std::format("login log: {}", env::login_log_enabled()));
     logger::log("env", "info", std::format("http log: {}", env::http_log_enabled()));
     logger::log("env", "info", std::format("jwt exp: {}", env::jwt_expiration()));
@@ -668,8 +1204,8 @@ void server::register_diagnostic_services() {
 
     register_webapi(webapi_path("/api/sysdate"), "Return server timestamp in local timezone", http::verb::GET,
         [this](http::request& req) {
-            const auto now {std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now())};
-            const auto server_ts {std::format("{:%FT%T}", std::chrono::get_tzdb().current_zone()->to_local(now))};
+            clock_cache::timestamp_buffer ts;
+            const auto server_ts {clock_cache::local_timestamp(ts)};
             constexpr auto json {R"({{"status": "OK", "data":[{{"pod":"{}","time":"{}"}}]}})"};
             req.response.set_body(std::format(json, pod_name, server_ts));
         }, false);
@@ -691,6 +1227,20 @@ void server::register_diagnostic_services() {
             body.append(std::format(str_tpl, "cpp_active_threads_current", "Current active threads", pod_name, active_threads_count));
             body.append(std::format(str_tpl, "cpp_pool_size", "Thread pool size", pod_name, pool_size));
             body.append(std::format(flt_tpl, "cpp_request_duration_avg_seconds", "Average request processing time in seconds", pod_name, avg_time));
+            constexpr auto cnt_tpl {"# HELP {0} {1}.\n# TYPE {0} counter\n{0}{{pod=\"{2}\",kind=\"{3}\"}} {4}\n"};
+            body.append(std::format(cnt_tpl, "cpp_connection_timeouts_total", "Connections closed by a deadline", pod_name, "header", m_metrics.timeouts_header.load(std::memory_order_relaxed)));
+            body.append(std::format("cpp_connection_timeouts_total{{pod=\"{}\",kind=\"{}\"}} {}\n", pod_name, "body", m_metrics.timeouts_body.load(std::memory_order_relaxed)));
+            body.append(std::format("cpp_connection_timeouts_total{{pod=\"{}\",kind=\"{}\"}} {}\n", pod_name, "idle", m_metrics.timeouts_idle.load(std::memory_order_relaxed)));
+            body.append(std::format("cpp_connection_timeouts_total{{pod=\"{}\",kind=\"{}\"}} {}\n", pod_name, "write", m_metrics.timeouts_write.load(std::memory_order_relaxed)));
+            constexpr auto total_tpl {"# HELP {0} {1}.\n# TYPE {0} counter\n{0}{{pod=\"{2}\"}} {3}\n"};
+            body.append(std::format(total_tpl, "cpp_compression_responses_total", "Responses sent with gzip or deflate", pod_name, m_metrics.compressed_responses.load(std::memory_order_relaxed)));
+            body.append(std::format(total_tpl, "cpp_compression_saved_bytes_total", "Response bytes saved by compression", pod_name, m_metrics.compression_saved_bytes.load(std::memory_order_relaxed)));
+            body.append(std::format(total_tpl, "cpp_compression_seconds_total", "Time spent compressing responses in seconds", pod_name, m_metrics.compression_time.load(std::memory_order_relaxed)));
+            body.append(std::format(total_tpl, "cpp_not_modified_total", "GET responses answered with 304 Not Modified", pod_name, m_metrics.not_modified.load(std::memory_order_relaxed)));
+            body.append(std::format(total_tpl, "cpp_response_cache_hits_total", "GET requests answered from the response cache", pod_name, m_metrics.cache_hits.load(std::memory_order_relaxed)));
+            body.append(std::format(total_tpl, "cpp_response_cache_misses_total", "GET requests of cached APIs sent to the workers", pod_name, m_metrics.cache_misses.load(std::memory_order_relaxed)));
+            body.append(std::format(str_tpl, "cpp_response_cache_bytes", "Memory used by the response cache", pod_name, m_cache.bytes()));
+            body.append(std::format(str_tpl, "cpp_response_cache_entries", "Responses in the response cache", pod_name, m_cache.entries()));
             req.response.set_body(body, "text/plain; version=0.0.4");
         }, false);
 }
@@ -712,9 +1262,9 @@ void server::prebuilt_services() {
                 const std::string login_ok {std::format(json, lr.get_display_name(), token)};
                 req.response.set_body(login_ok);
                 if (env::login_log_enabled())
-                    logger::log("security", "info", std::format("login OK - SID: {} user: {} IP: {} token: {} roles: {}", sid, login, req.remote_ip, token, lr.get_roles()), req.get_header("x-request-id"));
+                    logger::log("security", "info", std::format("login OK - SID: {} user: {} IP: {} token: {} roles: {}", sid, login, req.remote_ip, token, lr.get_roles()), req.get_header(http::header_table::known::x_request_id));
             } else {
-                logger::log("security", "warn", std::format("login failed - user: {} IP: {}", login, req.remote_ip), req.get_header("x-request-id"));
+                logger::log("security", "warn", std::format("login failed - user: {} IP: {}", login, req.remote_ip), req.get_header(http::header_table::known::x_request_id));
                 constexpr auto json = R"({{"status":"INVALID","validation":{{"id":"login","code":"{}","description":"{}"}}}})";
                 req.response.set_body(std::format(json, lr.get_error_code(), lr.get_error_description()));
             }
@@ -751,6 +1301,12 @@ void server::shutdown() {
 void server::start() {
 	auto init_time = std::chrono::high_resolution_clock::now();
     prebuilt_services();
+    try {
+        build_router();
+    } catch (const server_startup_exception& e) {
+        logger::log("server", "error", e.what());
+        return;
+    }
     enable_audit = env::enable_audit();
     print_server_info();
     const auto pool_size {env::pool_size()};
@@ -24,6 +24,11 @@
 #include "jwt.h"
 #include "email.h"
 #include "http_client.h"
+#include "uring.h"
+#include "timer_wheel.h"
+#include "simd_scan.h"
+#include "router.h"
+#include "response_cache.h"
 
 extern const char SERVER_VERSION[];
 extern const char* const LOGGER_SRC;
@@ -87,6 +92,82 @@ struct std::formatter<file_descriptor> : std::formatter<int> {
 	}
 };
 
+// Dense table of reusable connection slots indexed by fd. A slot and its request buffers are
+// allocated the first time an fd number shows up and recycled afterwards, so steady-state
+// accept/close does not allocate. The epoll key packs the fd with the slot generation,
+// events queued for a previous owner of the same fd number are discarded.
+class connection_slab {
+public:
+    explicit connection_slab(size_t initial_size = 1024) {
+        m_slots.resize(initial_size);
+    }
+
+    static constexpr uint64_t make_key(int fd, uint32_t generation) noexcept {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    static constexpr int key_fd(uint64_t key) noexcept {
+        return static_cast<int>(key & 0xFFFFFFFF);
+    }
+
+    // returns nullptr if the slot is still in use
+    http::request* acquire(int epoll_fd, int fd, const sockaddr_in& addr) {
+        const auto idx {static_cast<size_t>(fd)};
+        if (idx >= m_slots.size())
+            m_slots.resize(std::max(idx + 1, m_slots.size() * 2));
+        auto& s {m_slots[idx]};
+        if (!s)
+            s = std::make_unique<slot>();
+        else if (s->in_use)
+            return nullptr;
+        s->in_use = true;
+        s->timer.fd = fd;
+        http::request& req {s->req};
+        req.epoll_fd = epoll_fd;
+        req.fd = fd;
+        req.peer_addr = addr;
+        req.requests_served = 0;
+        ++req.generation;
+        req.reset();
+        return &req;
+    }
+
+    // returns nullptr for a free slot or a stale generation
+    http::request* get(uint64_t key) noexcept {
+        const auto idx {static_cast<size_t>(key_fd(key))};
+        if (idx >= m_slots.size() || !m_slots[idx] || !m_slots[idx]->in_use)
+            return nullptr;
+        if (http::request& req {m_slots[idx]->req}; req.generation == static_cast<uint32_t>(key >> 32))
+            return &req;
+        return nullptr;
+    }
+
+    // in-use slot for fd regardless of generation
+    http::request* find(int fd) noexcept {
+        if (const auto idx {static_cast<size_t>(fd)}; idx < m_slots.size() && m_slots[idx] && m_slots[idx]->in_use)
+            return &m_slots[idx]->req;
+        return nullptr;
+    }
+
+    // deadline node of the slot, must be cancelled before the slot is released
+    timer_wheel::node& timer(int fd) noexcept {
+        return m_slots[static_cast<size_t>(fd)]->timer;
+    }
+
+    void release(int fd) noexcept {
+        if (const auto idx {static_cast<size_t>(fd)}; idx < m_slots.size() && m_slots[idx])
+            m_slots[idx]->in_use = false;
+    }
+
+private:
+    struct slot {
+        http::request req;
+        timer_wheel::node timer;
+        bool in_use {false};
+    };
+    std::vector<std::unique_ptr<slot>> m_slots;
+};
+
 // Compile-time validated path for WebAPIs
 struct webapi_path {
 public:
@@ -101,9 +182,14 @@ public:
             throw std::string("Invalid WebAPI path -> cannot end with '/'");
         }
         std::string_view valid_chars{"abcdefghijklmnopqrstuvwxyz_-0123456789/"};
-        for(const char& c: _path)
-            if (!valid_chars.contains(c))
+        for (size_t i = 0; i < _path.size(); i++) {
+            if (_path[i] == '{') {
+                i = check_param(_path, i);
+                continue;
+            }
+            if (!valid_chars.contains(_path[i]))
                 throw std::string("Invalid WebAPI path -> contains an invalid character");
+        }
     }
     
     std::string get() const  {
@@ -111,6 +197,23 @@ public:
     }
 
 private: 
+    // a path parameter {name} or {name:int|str} must be a whole segment, returns the position of its '}'
+    static consteval size_t check_param(std::string_view _path, size_t open) {
+        const auto close {_path.find('}', open)};
+        if (close == std::string_view::npos || _path[open - 1] != '/' || (close + 1 < _path.size() && _path[close + 1] != '/')) {
+            throw std::string("Invalid WebAPI path -> a path parameter must be a whole segment");
+        }
+        const std::string_view spec {_path.substr(open + 1, close - open - 1)};
+        const std::string_view name {spec.substr(0, spec.find(':'))};
+        if (name.empty() || name.find_first_not_of("abcdefghijklmnopqrstuvwxyz_0123456789") != std::string_view::npos) {
+            throw std::string("Invalid WebAPI path -> invalid path parameter name");
+        }
+        if (const auto type {spec.substr(name.size())}; !type.empty() && type != ":int" && type != ":str") {
+            throw std::string("Invalid WebAPI path -> path parameter type must be int or str");
+        }
+        return close;
+    }
+
     std::string_view m_path;
 };
 
@@ -121,20 +224,52 @@ public:
     struct webapi {
         std::string description;
         http::verb verb;
-        std::vector<http::input_rule> rules;
+        http::validation_plan rules; // compiled from the input rules
         std::vector<std::string> roles;
         std::function<void(http::request&)> fn;
         bool is_secure {true};
+        size_t max_body_size {0}; // bytes, 0 uses CPP_MAX_BODY_KB
+        bool compress {true}; // gzip/deflate the response if the client accepts it
+        std::string cache_control; // GET responses get an ETag and this Cache-Control, empty means no-store
+        std::chrono::seconds cache_ttl {0}; // GET responses are kept in the response cache, 0 means not cached
 
         webapi(std::string _description, http::verb _verb, 
                std::vector<http::input_rule> _rules, std::vector<std::string> _roles, 
-               std::function<void(http::request&)> _fn, bool _is_secure);
+               std::function<void(http::request&)> _fn, bool _is_secure, size_t _max_body_size, bool _compress,
+               std::string_view _cache_control, std::chrono::seconds _cache_ttl);
     };
     
+    // One event loop: owns its SO_REUSEPORT listen socket, epoll instance and connection table
+    struct reactor {
+        int id {0};
+        file_descriptor epoll_fd;
+        file_descriptor listen_fd;
+        file_descriptor wake_fd;
+        file_descriptor timer_fd;
+        connection_slab connections;
+        timer_wheel timers {std::chrono::milliseconds{100}};
+        uint64_t timer_tick {0}; // the timerfd is armed for the start of this tick, 0 when disarmed
+        std::queue<http::request*> ready_queue;
+        std::mutex ready_mutex;
+#ifdef CPP_IO_URING
+        // io_uring backend when set, epoll otherwise; declared last so it's destroyed before the connections it references
+        std::unique_ptr<uring::ring> ring;
+#endif
+    };
+
+    // A router entry: a registered API, or a built-in answered by the reactor itself
+    struct route {
+        enum class builtin : uint8_t { none, ping, sysinfo };
+        std::shared_ptr<const webapi> api;
+        builtin kind {builtin::none};
+    };
+
     // --- Public Structs (Moved from private section) ---
+    // the request stays in its reactor's connection table, the fd is disarmed (EPOLLONESHOT) while a worker owns it
     struct worker_params {
-        http::request req;
+        http::request* req {nullptr};
         std::shared_ptr<const webapi> api;
+        reactor* owner {nullptr};
     };
     struct audit_trail {
         std::string username;
@@ -153,6 +288,16 @@ public:
         std::atomic<double> total_processing_time{0};
         std::atomic<int> active_threads{0};
         std::atomic<size_t> connections{0};
+        std::atomic<size_t> timeouts_header{0};
+        std::atomic<size_t> timeouts_body{0};
+        std::atomic<size_t> timeouts_idle{0};
+        std::atomic<size_t> timeouts_write{0};
+        std::atomic<size_t> compressed_responses{0};
+        std::atomic<size_t> compression_saved_bytes{0};
+        std::atomic<double> compression_time{0};
+        std::atomic<size_t> not_modified{0};
+        std::atomic<size_t> cache_hits{0};
+        std::atomic<size_t> cache_misses{0};
     };
 
 
@@ -169,7 +314,11 @@ public:
         RulesType&& _rules,
         RolesType&& _roles,
         FnType&& _fn,
-        const bool _is_secure = true)
+        const bool _is_secure = true,
+        const size_t _max_body_size = 0,
+        const bool _compress = true,
+        const std::string_view _cache_control = "",
+        const std::chrono::seconds _cache_ttl = std::chrono::seconds{0})
     {
         webapi_catalog.try_emplace(
             _path.get(),
@@ -179,7 +328,11 @@ public:
                 std::forward<RulesType>(_rules),
                 std::forward<RolesType>(_roles),
                 std::forward<FnType>(_fn),
-                _is_secure
+                _is_secure,
+                _max_body_size,
+                _compress,
+                _cache_control,
+                _cache_ttl
             )
         );
     }
@@ -191,7 +344,11 @@ public:
         DescType&& _description,
         const http::verb& _verb,
         FnType&& _fn,
-        const bool _is_secure = true)
+        const bool _is_secure = true,
+        const size_t _max_body_size = 0,
+        const bool _compress = true,
+        const std::string_view _cache_control = "",
+        const std::chrono::seconds _cache_ttl = std::chrono::seconds{0})
     {
         register_webapi(
             _path,
@@ -200,7 +357,11 @@ public:
             std::vector<http::input_rule>{},
             std::vector<std::string>{},
             std::forward<FnType>(_fn),
-            _is_secure
+            _is_secure,
+            _max_body_size,
+            _compress,
+            _cache_control,
+            _cache_ttl
         );
     }
 	
@@ -214,39 +375,69 @@ private:
     void send_options(http::request& req);
     void send_error(http::request& req, http::status status, std::string_view msg);
     void save_audit_trail(audit_trail& at);
+    void record_audit(const http::request& req);
     void execute_service(http::request& req, const std::shared_ptr<const webapi>& api_ptr);
-    void process_request(http::request& req, const std::shared_ptr<const webapi>& api_ptr) ;
+    bool process_request(http::request& req, const std::shared_ptr<const webapi>& api_ptr) ;
+    void compress_response(http::request& req);
     void log_request(const http::request& req, double duration) ;
     void http_server(http::request& req, const std::shared_ptr<const webapi>& api_ptr) ;
-    bool read_request(http::request& req, int bytes) ;
+    bool make_cache_key(http::request& req, const webapi& api) ;
+    bool send_cached(reactor& r, http::request& req, const webapi& api) ;
+    bool read_request(http::request& req, int bytes, std::string_view received = {}) ;
+    const route* find_route(http::request& req) const noexcept;
+    void build_router();
+    size_t max_body_size(const webapi* api) const noexcept;
+    bool accept_upload(http::request& req) ;
     int get_signalfd() ;
     int get_listenfd(int port) ;
     void epoll_add_event(int fd, int epoll_fd, uint32_t event_flags) ;
-    void epoll_handle_error(const epoll_event& ev) ;
-    void epoll_handle_close(const epoll_event& ev) ;
-    void epoll_handle_connect(const int& listen_fd, const int& epoll_fd) ;
-    void epoll_abort_request(http::request& req, http::status status_code, std::string_view msg_ = "") ;
-    void check_ready_queue() ;
+    void epoll_handle_error(reactor& r, const epoll_event& ev) ;
+    void epoll_handle_close(reactor& r, const epoll_event& ev) ;
+    void epoll_handle_connect(reactor& r) ;
+    void epoll_abort_request(reactor& r, http::request& req, http::status status_code, std::string_view msg_ = "") ;
+    void check_ready_queue(reactor& r) ;
+    void notify_ready(reactor& r, http::request* req) ;
+    void rearm(reactor& r, http::request& req, uint32_t event_flags) ;
+    void arm_timer(reactor& r, http::request& req, uint32_t event_flags) ;
+    void arm_timerfd(reactor& r, uint64_t tick) ;
+    void epoll_close_connection(reactor& r, int fd) ;
     void producer(worker_params& wp) ;
-    void run_async_task(http::request& req) ;
-    void epoll_send_ping(http::request& req);
-    void epoll_send_sysinfo(http::request& req) ;
-    void epoll_handle_read(http::request& req) ;
-    void epoll_handle_write(http::request& req) ;
-    void epoll_handle_IO(const epoll_event& ev) ;
-    void epoll_loop(int listen_fd, int epoll_fd) ;
+    void run_async_task(reactor& r, http::request& req) ;
+    void epoll_send_ping(reactor& r, http::request& req);
+    void epoll_send_sysinfo(reactor& r, http::request& req) ;
+    void epoll_handle_read(reactor& r, http::request& req) ;
+    void epoll_handle_write(reactor& r, http::request& req) ;
+    void complete_write(reactor& r, http::request& req) ;
+    void expire_timers(reactor& r) ;
+    void epoll_handle_IO(reactor& r, const epoll_event& ev) ;
+    void epoll_loop(reactor& r) ;
+#ifdef CPP_IO_URING
+    void uring_loop(reactor& r) ;
+    bool uring_handle_completion(reactor& r, const io_uring_cqe* cqe) ;
+    void uring_handle_accept(reactor& r, const io_uring_cqe* cqe) ;
+    void uring_handle_recv(reactor& r, http::request& req, const io_uring_cqe* cqe) ;
+    void uring_handle_send(reactor& r, http::request& req, const io_uring_cqe* cqe) ;
+#endif
+    void run_reactor(reactor& r) ;
+    void epoll_register(reactor& r) ;
+    std::unique_ptr<reactor> create_reactor(int id, int port, bool use_uring) ;
     void start_epoll(int port) ;
     void print_server_info() ;
     void register_diagnostic_services();
     void prebuilt_services();
-	bool is_origin_allowed(const std::string& origin);
+	bool is_origin_allowed(std::string_view origin);
 	void shutdown();
 
     // --- Private Members ---
     std::unordered_map<std::string, std::shared_ptr<const webapi>, util::string_hash, std::equal_to<>> webapi_catalog;
-    std::unordered_map<int, http::request> buffers;
+    // built from the catalog when the server starts, read-only after that
+    router::radix_tree m_router;
+    std::vector<route> m_routes;
+    std::vector<std::unique_ptr<reactor>> m_reactors;
     
     server_metrics m_metrics;
+    // responses of the APIs registered with a cache TTL, looked up by the reactors
+    response_cache m_cache;
 
     std::queue<worker_params> m_queue;
     std::condition_variable m_cond;
@@ -256,9 +447,6 @@ private:
     std::condition_variable m_audit_cond;
     std::mutex m_audit_mutex;
 
-    std::queue<http::request> m_ready_queue;
-    std::mutex m_ready_mutex;
-    
     file_descriptor m_signal;
     const std::string pod_name;
     const std::string server_start_date;
@@ -0,0 +1,101 @@
+#include "simd_scan.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPP_SIMD_X86
+#endif
+
+namespace
+{
+	using find_fn = size_t (*)(const char* s, size_t n, const char* needle, size_t m, size_t pos) noexcept;
+
+	size_t find_scalar(const char* s, size_t n, const char* needle, size_t m, size_t pos) noexcept
+	{
+		return std::string_view{s, n}.find(std::string_view{needle, m}, pos);
+	}
+
+#ifdef CPP_SIMD_X86
+	//a match needs the first and the last byte of the needle in place, the bytes in between are verified with memcmp
+	size_t find_sse2(const char* s, size_t n, const char* needle, size_t m, size_t pos) noexcept
+	{
+		constexpr size_t width {16};
+		const __m128i first {_mm_set1_epi8(needle[0])};
+		const __m128i last {_mm_set1_epi8(needle[m - 1])};
+		size_t i {pos};
+		for (; i + m - 1 + width <= n; i += width) {
+			const __m128i block_first {_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i))};
+			const __m128i block_last {_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + m - 1))};
+			auto mask {static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))))};
+			while (mask) {
+				const auto bit {static_cast<size_t>(__builtin_ctz(mask))};
+				if (m <= 2 || !std::memcmp(s + i + bit + 1, needle + 1, m - 2))
+					return i + bit;
+				mask &= mask - 1;
+			}
+		}
+		return find_scalar(s, n, needle, m, i);
+	}
+
+	__attribute__((target("avx2")))
+	size_t find_avx2(const char* s, size_t n, const char* needle, size_t m, size_t pos) noexcept
+	{
+		constexpr size_t width {32};
+		const __m256i first {_mm256_set1_epi8(needle[0])};
+		const __m256i last {_mm256_set1_epi8(needle[m - 1])};
+		size_t i {pos};
+		for (; i + m - 1 + width <= n; i += width) {
+			const __m256i block_first {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i))};
+			const __m256i block_last {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + m - 1))};
+			auto mask {static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))))};
+			while (mask) {
+				const auto bit {static_cast<size_t>(__builtin_ctz(mask))};
+				if (m <= 2 || !std::memcmp(s + i + bit + 1, needle + 1, m - 2))
+					return i + bit;
+				mask &= mask - 1;
+			}
+		}
+		return find_sse2(s, n, needle, m, i);
+	}
+#endif
+
+	struct kernel_info {
+		find_fn fn;
+		std::string_view name;
+	};
+
+	kernel_info select_kernel() noexcept
+	{
+#ifdef CPP_SIMD_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return {find_avx2, "avx2"};
+		return {find_sse2, "sse2"};
+#else
+		return {find_scalar, "scalar"};
+#endif
+	}
+
+	//function-local so it is safe to use from other static initializers
+	const kernel_info& active_kernel() noexcept
+	{
+		static const kernel_info k {select_kernel()};
+		return k;
+	}
+}
+
+namespace scan
+{
+	size_t find(std::string_view haystack, std::string_view needle, size_t pos) noexcept
+	{
+		// not worth a vector loop, nor an indirect call
+		if (needle.empty() || pos >= haystack.size() || haystack.size() - pos < 32)
+			return haystack.find(needle, pos);
+		return active_kernel().fn(haystack.data(), haystack.size(), needle.data(), needle.size(), pos);
+	}
+
+	std::string_view kernel() noexcept
+	{
+		return active_kernel().name;
+	}
+}
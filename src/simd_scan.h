@@ -0,0 +1,29 @@
+/**
+ * @file simd_scan.h
+ * @brief Vectorized substring search for the HTTP parser hot paths.
+ */
+
+#ifndef SIMD_SCAN_H_
+#define SIMD_SCAN_H_
+
+#include <string_view>
+
+/**
+ * @brief Vectorized substring search for the HTTP parser hot paths.
+ *
+ * Used to find CRLF, the end of the headers and multipart boundaries. Candidate positions are
+ * found by comparing 16 (SSE2) or 32 (AVX2) bytes at once against the first and last byte of the
+ * needle, only those are verified with memcmp. The kernel is selected once at startup with cpuid,
+ * so the binary keeps targeting -march=x86-64; other architectures use std::string_view::find.
+ * Single byte searches are left to std::string_view::find, glibc's memchr is already vectorized.
+ */
+namespace scan
+{
+	/** @brief same contract as std::string_view::find(needle, pos) */
+	size_t find(std::string_view haystack, std::string_view needle, size_t pos = 0) noexcept;
+
+	/** @brief name of the kernel selected for this CPU: avx2, sse2 or scalar */
+	std::string_view kernel() noexcept;
+}
+
+#endif /* SIMD_SCAN_H_ */
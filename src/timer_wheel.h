@@ -0,0 +1,181 @@
+/**
+ * @file timer_wheel.h
+ * @brief Two-level hierarchical timer wheel for per-connection deadlines.
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * @brief Two-level hierarchical timer wheel for per-connection deadlines.
+ *
+ * Nodes are intrusive (embedded in each connection slot), so schedule() and cancel() are O(1)
+ * and never allocate. Level 0 has one bucket per tick, level 1 one bucket per level 0 revolution;
+ * its buckets cascade into level 0 as the wheel turns. Deadlines longer than the wheel span are clamped.
+ * Single-threaded, each reactor owns one wheel driven by a one-shot timerfd armed for next_tick();
+ * an empty wheel is not turned at all, the next deadline scheduled moves it to the current time.
+ */
+class timer_wheel {
+public:
+	enum class kind : uint8_t {
+		none,
+		header_read,
+		body_read,
+		idle,
+		write_stall
+	};
+
+	struct node {
+		node* prev {nullptr};
+		node* next {nullptr};
+		uint64_t expires {0};
+		kind type {kind::none};
+		int fd {-1};
+
+		bool scheduled() const noexcept { return type != kind::none; }
+	};
+
+	explicit timer_wheel(std::chrono::milliseconds tick, std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now()) noexcept:
+		m_tick{tick}, m_start{start}
+	{
+		for (auto& b: m_level0) b.prev = b.next = &b;
+		for (auto& b: m_level1) b.prev = b.next = &b;
+	}
+
+	timer_wheel(const timer_wheel&) = delete;
+	timer_wheel& operator=(const timer_wheel&) = delete;
+
+	std::chrono::milliseconds tick() const noexcept { return m_tick; }
+
+	/** @brief when the given tick starts, ticks are counted from the construction of the wheel */
+	std::chrono::steady_clock::time_point time_of(uint64_t tick) const noexcept { return m_start + m_tick * tick; }
+
+	/** @brief (re)schedules n to expire after timeout from now, rounded up to the next tick */
+	void schedule(node& n, kind type, std::chrono::milliseconds timeout, std::chrono::steady_clock::time_point now) noexcept
+	{
+		cancel(n);
+		const auto now_tick {tick_at(now)};
+		if (m_count == 0)
+			m_current = std::max(m_current, now_tick);
+		const auto ticks {static_cast<uint64_t>((timeout + m_tick - std::chrono::milliseconds{1}) / m_tick)};
+		n.expires = std::max(m_current, now_tick) + std::max<uint64_t>(ticks, 1);
+		n.type = type;
+		insert(n);
+		++m_count;
+	}
+
+	void cancel(node& n) noexcept
+	{
+		if (!n.scheduled())
+			return;
+		n.prev->next = n.next;
+		n.next->prev = n.prev;
+		n.prev = n.next = nullptr;
+		n.type = kind::none;
+		--m_count;
+	}
+
+	/**
+	 * @brief tick of the earliest deadline, or of the cascade that brings it to level 0, whichever comes first;
+	 * 0 if the wheel is empty. Cancelled deadlines are not tracked, the tick returned may find nothing to expire.
+	 */
+	uint64_t next_tick() const noexcept
+	{
+		if (m_count == 0)
+			return 0;
+		uint64_t next {0};
+		for (uint64_t t = m_current + 1; t < m_current + slots; t++)
+			if (const node& b {m_level0[t & mask]}; b.next != &b) {
+				next = t;
+				break;
+			}
+		const uint64_t revolution {m_current >> bits};
+		for (uint64_t rev = revolution + 1; rev <= revolution + slots; rev++)
+			if (const node& b {m_level1[rev & mask]}; b.next != &b) {
+				const uint64_t cascade_tick {rev << bits};
+				return next && next < cascade_tick ? next : cascade_tick;
+			}
+		return next;
+	}
+
+	/** @brief turns the wheel up to now, fn(node&, kind) is called for each expired node after it was unlinked */
+	template<typename Fn>
+	void advance(std::chrono::steady_clock::time_point now, Fn&& fn)
+	{
+		const auto target {tick_at(now)};
+		while (m_current < target) {
+			++m_current;
+			if ((m_current & mask) == 0)
+				cascade(m_level1[(m_current >> bits) & mask]);
+			node& bucket {m_level0[m_current & mask]};
+			while (bucket.next != &bucket) {
+				node& n {*bucket.next};
+				const kind type {n.type};
+				cancel(n);
+				fn(n, type);
+			}
+		}
+	}
+
+private:
+	static constexpr unsigned bits {8};
+	static constexpr uint64_t slots {1 << bits};
+	static constexpr uint64_t mask {slots - 1};
+
+	uint64_t tick_at(std::chrono::steady_clock::time_point now) const noexcept
+	{
+		return now > m_start ? static_cast<uint64_t>((now - m_start) / m_tick) : 0;
+	}
+
+	static void link(node& bucket, node& n) noexcept
+	{
+		n.prev = bucket.prev;
+		n.next = &bucket;
+		bucket.prev->next = &n;
+		bucket.prev = &n;
+	}
+
+	void insert(node& n) noexcept
+	{
+		const uint64_t max_expires {m_current + slots * slots - 1};
+		n.expires = std::min(n.expires, max_expires);
+		if (n.expires - m_current < slots)
+			link(m_level0[n.expires & mask], n);
+		else
+			link(m_level1[(n.expires >> bits) & mask], n);
+	}
+
+	// moves a level 1 bucket down to level 0 when its revolution begins
+	void cascade(node& bucket) noexcept
+	{
+		node pending;
+		pending.prev = pending.next = &pending;
+		while (bucket.next != &bucket) {
+			node& n {*bucket.next};
+			bucket.next = n.next;
+			n.next->prev = &bucket;
+			link(pending, n);
+		}
+		while (pending.next != &pending) {
+			node& n {*pending.next};
+			pending.next = n.next;
+			n.next->prev = &pending;
+			insert(n);
+		}
+	}
+
+	std::chrono::milliseconds m_tick;
+	std::chrono::steady_clock::time_point m_start;
+	uint64_t m_current {0};
+	size_t m_count {0}; //scheduled nodes
+	std::array<node, slots> m_level0;
+	std::array<node, slots> m_level1;
+};
+
+#endif /* TIMER_WHEEL_H_ */
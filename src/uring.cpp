@@ -0,0 +1,119 @@
+#include "uring.h"
+
+#ifdef CPP_IO_URING
+
+#include <format>
+#include <cstring>
+#include <poll.h>
+
+namespace
+{
+	constexpr int buffer_group {0};
+}
+
+namespace uring
+{
+	ring::ring(unsigned entries, unsigned short buffers, unsigned buffer_size, unsigned short accepts):
+		m_accepts(accepts), m_buffers(static_cast<size_t>(buffers) * buffer_size), m_buffer_count{buffers}, m_buffer_size{buffer_size}
+	{
+		if (int rc {io_uring_queue_init(entries, &m_ring, IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_R_DISABLED)}; rc < 0)
+			throw setup_error(std::format("io_uring_queue_init() failed: {}", std::strerror(-rc)));
+
+		int rc {0};
+		m_buf_ring = io_uring_setup_buf_ring(&m_ring, m_buffer_count, buffer_group, 0, &rc);
+		if (!m_buf_ring) {
+			io_uring_queue_exit(&m_ring);
+			throw setup_error(std::format("io_uring_setup_buf_ring() failed: {}", std::strerror(-rc)));
+		}
+		for (unsigned short i = 0; i < m_buffer_count; i++)
+			io_uring_buf_ring_add(m_buf_ring, &m_buffers[static_cast<size_t>(i) * m_buffer_size], m_buffer_size, i, io_uring_buf_ring_mask(m_buffer_count), i);
+		io_uring_buf_ring_advance(m_buf_ring, m_buffer_count);
+	}
+
+	ring::~ring()
+	{
+		io_uring_free_buf_ring(&m_ring, m_buf_ring, m_buffer_count, buffer_group);
+		io_uring_queue_exit(&m_ring);
+	}
+
+	void ring::enable()
+	{
+		if (int rc {io_uring_enable_rings(&m_ring)}; rc < 0)
+			throw setup_error(std::format("io_uring_enable_rings() failed: {}", std::strerror(-rc)));
+	}
+
+	io_uring_sqe* ring::get_sqe()
+	{
+		io_uring_sqe* sqe {io_uring_get_sqe(&m_ring)};
+		if (!sqe) {
+			//submission queue is full, flush it and try again
+			io_uring_submit(&m_ring);
+			sqe = io_uring_get_sqe(&m_ring);
+		}
+		return sqe;
+	}
+
+	void ring::accept(int listen_fd, uint32_t slot)
+	{
+		accept_slot& a {m_accepts[slot]};
+		a.addr_len = sizeof(a.addr);
+		io_uring_sqe* sqe {get_sqe()};
+		io_uring_prep_accept(sqe, listen_fd, static_cast<sockaddr*>(static_cast<void*>(&a.addr)), &a.addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		io_uring_sqe_set_data64(sqe, make_tag(op::accept, listen_fd, slot));
+	}
+
+	void ring::poll(int fd, op o, bool multishot)
+	{
+		io_uring_sqe* sqe {get_sqe()};
+		if (multishot)
+			io_uring_prep_poll_multishot(sqe, fd, POLLIN);
+		else
+			io_uring_prep_poll_add(sqe, fd, POLLIN);
+		io_uring_sqe_set_data64(sqe, make_tag(o, fd, 0));
+	}
+
+	void ring::recv(int fd, uint32_t generation)
+	{
+		io_uring_sqe* sqe {get_sqe()};
+		io_uring_prep_recv(sqe, fd, nullptr, m_buffer_size, 0);
+		io_uring_sqe_set_flags(sqe, IOSQE_BUFFER_SELECT);
+		sqe->buf_group = buffer_group;
+		io_uring_sqe_set_data64(sqe, make_tag(op::recv, fd, generation));
+	}
+
+	void ring::send(int fd, uint32_t generation, std::span<const std::string_view> chunks)
+	{
+		for (size_t i = 0; i < chunks.size(); i++) {
+			const bool last {i + 1 == chunks.size()};
+			io_uring_sqe* sqe {get_sqe()};
+			io_uring_prep_send(sqe, fd, chunks[i].data(), chunks[i].size(), MSG_NOSIGNAL | MSG_WAITALL);
+			if (!last)
+				io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK);
+			io_uring_sqe_set_data64(sqe, make_tag(last ? op::send : op::send_link, fd, generation));
+		}
+	}
+
+	int ring::wait()
+	{
+		return io_uring_submit_and_wait(&m_ring, 1);
+	}
+
+	std::string_view ring::buffer(const io_uring_cqe* cqe) const noexcept
+	{
+		if (!(cqe->flags & IORING_CQE_F_BUFFER) || cqe->res <= 0)
+			return {};
+		const auto id {static_cast<size_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT)};
+		return std::string_view{&m_buffers[id * m_buffer_size], static_cast<size_t>(cqe->res)};
+	}
+
+	void ring::recycle(const io_uring_cqe* cqe) noexcept
+	{
+		if (!(cqe->flags & IORING_CQE_F_BUFFER))
+			return;
+		const auto id {static_cast<unsigned short>(cqe->flags >> IORING_CQE_BUFFER_SHIFT)};
+		io_uring_buf_ring_add(m_buf_ring, &m_buffers[static_cast<size_t>(id) * m_buffer_size], m_buffer_size, id, io_uring_buf_ring_mask(m_buffer_count), 0);
+		io_uring_buf_ring_advance(m_buf_ring, 1);
+	}
+}
+
+#endif /* CPP_IO_URING */
@@ -0,0 +1,126 @@
+/**
+ * @file uring.h
+ * @brief Thin RAII wrapper over liburing for the optional io_uring reactor backend.
+ */
+
+#ifndef URING_H_
+#define URING_H_
+
+#ifdef CPP_IO_URING
+
+#include <liburing.h>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+/**
+ * @brief Thin RAII wrapper over liburing for the optional io_uring reactor backend.
+ *
+ * Each reactor owns one ring with a fixed number of accepts in flight on its listen socket, a ring of provided
+ * buffers for recv and at most one recv or send chain in flight per connection.
+ * Every accept has its own peer address buffer, a multishot accept would share one among all its completions
+ * and the address of a connection could be overwritten by the next one before it is read.
+ * Completions are tagged with the operation, the fd and the low 24 bits of the connection slot generation.
+ * The ring is created disabled with a single issuer: requests can be queued by the thread that builds it,
+ * but nothing is submitted until enable() binds it to the reactor thread, the only one allowed to submit.
+ * Compiled only with -DCPP_IO_URING (make IO_URING=1), linked with -luring.
+ */
+namespace uring
+{
+	enum class op : uint8_t {
+		accept = 1,
+		recv = 2,
+		send = 3,
+		wake = 4,
+		signal = 5,
+		send_link = 6, //all but the last send of a linked chain
+		timer = 7
+	};
+
+	constexpr uint32_t generation_mask {0xFFFFFF};
+
+	constexpr uint64_t make_tag(op o, int fd, uint32_t generation) noexcept
+	{
+		return (static_cast<uint64_t>(o) << 56) | (static_cast<uint64_t>(generation & generation_mask) << 32) | static_cast<uint32_t>(fd);
+	}
+
+	constexpr op tag_op(uint64_t tag) noexcept { return static_cast<op>(tag >> 56); }
+	constexpr int tag_fd(uint64_t tag) noexcept { return static_cast<int>(tag & 0xFFFFFFFF); }
+	constexpr uint32_t tag_generation(uint64_t tag) noexcept { return static_cast<uint32_t>(tag >> 32) & generation_mask; }
+
+	class setup_error : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	class ring {
+	public:
+		/** @brief throws setup_error if the kernel does not support the required io_uring features */
+		ring(unsigned entries, unsigned short buffers, unsigned buffer_size, unsigned short accepts);
+		~ring();
+
+		ring(const ring&) = delete;
+		ring& operator=(const ring&) = delete;
+		ring(ring&&) = delete;
+		ring& operator=(ring&&) = delete;
+
+		/** @brief must be called by the thread that runs the ring, throws setup_error */
+		void enable();
+
+		/** @brief accept on one of the slots, its completion is tagged with the slot number as generation */
+		void accept(int listen_fd, uint32_t slot);
+
+		/** @brief peer address of the connection returned by the last accept on the slot */
+		const sockaddr_in& peer_addr(uint32_t slot) const noexcept { return m_accepts[slot].addr; }
+
+		void poll(int fd, op o, bool multishot);
+		void recv(int fd, uint32_t generation);
+
+		/** @brief submits one send per chunk, linked so they hit the socket in order */
+		void send(int fd, uint32_t generation, std::span<const std::string_view> chunks);
+
+		/** @brief submits pending requests and waits for at least one completion */
+		int wait();
+
+		template<typename Fn>
+		void for_each_completion(Fn&& fn)
+		{
+			unsigned head;
+			unsigned count {0};
+			io_uring_cqe* cqe;
+			io_uring_for_each_cqe(&m_ring, head, cqe) {
+				fn(cqe);
+				recycle(cqe);
+				++count;
+			}
+			io_uring_cq_advance(&m_ring, count);
+		}
+
+		/** @brief data received in the provided buffer of a recv completion */
+		std::string_view buffer(const io_uring_cqe* cqe) const noexcept;
+
+	private:
+		io_uring_sqe* get_sqe();
+		void recycle(const io_uring_cqe* cqe) noexcept;
+
+		struct accept_slot {
+			sockaddr_in addr{};
+			socklen_t addr_len{sizeof(sockaddr_in)};
+		};
+
+		io_uring m_ring{};
+		std::vector<accept_slot> m_accepts;
+		io_uring_buf_ring* m_buf_ring{nullptr};
+		std::vector<char> m_buffers;
+		unsigned short m_buffer_count;
+		unsigned m_buffer_size;
+	};
+}
+
+#endif /* CPP_IO_URING */
+
+#endif /* URING_H_ */
@@ -1,4 +1,5 @@
 #include "util.h"
+#include "clock_cache.h"
 
 namespace {
 	
@@ -30,7 +31,8 @@ namespace util
 	
 	std::string current_timestamp() noexcept
 	{
-		return std::format("{:%FT%T}", std::chrono::get_tzdb().current_zone()->to_local(std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now())));
+		clock_cache::timestamp_buffer ts;
+		return std::string{clock_cache::local_timestamp(ts)};
 	}	
 	
 	std::string encode_json(const std::string& s) noexcept